@@ -0,0 +1,144 @@
+// BPT::BPlusTree on its own.
+//
+// churn - insert keys, remove most of them, then look up and scan what is
+//         left. Compares removing entries at once with lazy removal.
+// load  - build a tree from sorted keys by inserting them one at a time,
+//         by bulk_load, and by copying a tree.
+
+#include <bplustree.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+#include <random>
+#include <vector>
+
+/*
+ * Count live heap bytes so we can report what the tree holds on to.
+ * The allocator knows how big each block is, so the count is of usable
+ * bytes - a little over what was asked for - and nothing is stored in
+ * the blocks themselves.
+ */
+static std::size_t live_bytes = 0;
+
+static void *counted(void *p) {
+    if (not p) throw std::bad_alloc();
+    live_bytes += malloc_usable_size(p);
+    return p;
+}
+
+static void released(void *ptr) noexcept {
+    live_bytes -= malloc_usable_size(ptr);      // 0 for nullptr
+    std::free(ptr);
+}
+
+void *operator new(std::size_t size) {
+    return counted(std::malloc(std::max<std::size_t>(size, 1)));
+}
+
+void operator delete(void *ptr) noexcept { released(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { released(ptr); }
+
+// B+tree internal nodes are cache line aligned.
+void *operator new(std::size_t size, std::align_val_t align) {
+    auto a = std::size_t(align);
+    return counted(std::aligned_alloc(a, (std::max<std::size_t>(size, 1) + a - 1) / a * a));
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept { released(ptr); }
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept { released(ptr); }
+
+constexpr std::size_t key_count = 1'000'000;
+
+using tree_type = BPT::BPlusTree<long, long, 64>;
+
+template<class Fn>
+double time_ms(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+int depth_of(const tree_type &tree) {
+    return int(tree.height()) + 1;
+}
+
+void churn(const char *name, bool lazy, const std::vector<long> &keys) {
+    auto before = live_bytes;
+    auto *tree = new tree_type;
+    tree->lazy_removal(lazy);
+
+    for (auto k : keys) {
+        tree->insert(k, k);
+    }
+
+    auto remove = time_ms([&] {
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            if (i % 10 != 0) tree->remove(keys[i]);
+        }
+    });
+
+    std::size_t found = 0;
+    auto find = time_ms([&] {
+        for (auto k : keys) {
+            found += tree->contains(k);
+        }
+    });
+
+    unsigned long sum = 0;
+    auto scan = time_ms([&] {
+        for (auto const &kv : *tree) {
+            sum += static_cast<unsigned long>(kv.value);
+        }
+    });
+
+    std::printf("churn  %-6s remove %7.1f ms  find %7.1f ms  scan %6.2f ms  depth %d  %6.1f MB  [%zu %lu]\n",
+        name, remove, find, scan, depth_of(*tree), double(live_bytes - before) / (1 << 20), found, sum);
+
+    delete tree;
+}
+
+void load(const std::vector<long> &keys) {
+    std::vector<std::pair<long, long>> sorted;
+    sorted.reserve(keys.size());
+    for (auto k : keys) {
+        sorted.push_back({k, k});
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    tree_type inserted;
+    auto insert = time_ms([&] {
+        for (auto const &e : sorted) {
+            inserted.insert(e.first, e.second);
+        }
+    });
+
+    tree_type loaded;
+    auto bulk = time_ms([&] { loaded.bulk_load(sorted); });
+
+    tree_type copied;
+    auto copy = time_ms([&] { copied = loaded; });
+
+    std::printf("load   insert %7.1f ms  bulk_load %6.1f ms  copy %6.1f ms  depth %d / %d\n",
+        insert, bulk, copy, depth_of(inserted), depth_of(loaded));
+}
+
+int main() {
+    std::mt19937_64 rng(42);
+    std::vector<long> keys(key_count);
+    for (auto &k : keys) {
+        k = long(rng() >> 1);
+    }
+
+    std::printf("keys %zu, fan out %zu\n", key_count, tree_type::fan_out);
+
+    churn("eager", false, keys);
+    churn("lazy", true, keys);
+    load(keys);
+}
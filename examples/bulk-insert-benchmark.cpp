@@ -0,0 +1,79 @@
+// Loading a table row by row vs with insert_rows.
+
+#include <memorandum.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Memorandum;
+
+struct note {
+    long id;
+    long tick;
+    int track;
+    std::string name;
+    bool operator==(const note &) const = default;
+};
+
+constexpr std::size_t row_count = 500'000;
+
+template<class Fn>
+double time_ms(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+std::vector<note> make_rows() {
+    std::vector<note> rows;
+    rows.reserve(row_count);
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<long> tick(0, 10'000'000);
+    for (std::size_t i = 0; i < row_count; ++i) {
+        rows.push_back({long(i), tick(rng), int(i % 64), "note " + std::to_string(i)});
+    }
+
+    return rows;
+}
+
+template<class T>
+void add_indexes(T &table) {
+    table.template create_index<long>("id", [](const note &n) { return n.id; });
+    table.template create_multi_index<long>("tick", [](const note &n) { return n.tick; });
+    table.template create_multi_index<int>("track", [](const note &n) { return n.track; });
+}
+
+int main() {
+    auto rows = make_rows();
+
+    auto one_by_one = time_ms([&] {
+        Table<note> table;
+        add_indexes(table);
+        for (auto const &r : rows) {
+            table.insert_row(r);
+        }
+    });
+
+    auto bulk = time_ms([&] {
+        Table<note> table;
+        add_indexes(table);
+        table.insert_rows(rows);
+    });
+
+    auto bulk_move = time_ms([&] {
+        auto copy = rows;
+        Table<note> table;
+        add_indexes(table);
+        table.insert_rows(std::move(copy));
+    });
+
+    std::printf("rows %zu, 3 indexes\n", row_count);
+    std::printf("  insert_row loop        %9.3f ms\n", one_by_one);
+    std::printf("  insert_rows (copy)     %9.3f ms\n", bulk);
+    std::printf("  insert_rows (move)     %9.3f ms (includes copying the input)\n", bulk_move);
+}
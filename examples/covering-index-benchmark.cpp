@@ -0,0 +1,110 @@
+// Index-only queries: reading two fields of a wide row through a plain
+// index (which goes to the row) and through a covering index (which
+// answers from the index entry).
+
+#include <memorandum.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace Memorandum;
+
+struct order {
+    long id;
+    long tick;
+    double price;
+    int qty;
+    std::array<char, 240> notes;
+    bool operator==(const order &) const = default;
+};
+
+struct quote {
+    double price;
+    int qty;
+};
+
+constexpr std::size_t row_count = 1'000'000;
+constexpr std::size_t range_width = 1'000;
+
+template<class Fn>
+double time_ms(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+int main() {
+    std::mt19937 rng(11);
+
+    std::vector<order> rows;
+    rows.reserve(row_count);
+    for (std::size_t i = 0; i < row_count; ++i) {
+        rows.push_back({long(i), long(rng() % (row_count * 4)), double(i % 997), int(i % 13), {}});
+    }
+
+    Table<order> table;
+    table.insert_rows(rows);
+
+    auto &by_id = table.create_index<long, hash_storage<>>("id", [](const order &o) { return o.id; });
+    auto &by_tick = table.create_multi_index<long>("tick", [](const order &o) { return o.tick; });
+
+    auto &cover_id = table.create_covering_index<long, quote, hash_storage<>>("cover id",
+        [](const order &o) { return o.id; },
+        [](const order &o) { return quote{o.price, o.qty}; });
+    auto &cover_tick = table.create_covering_multi_index<long, quote>("cover tick",
+        [](const order &o) { return o.tick; },
+        [](const order &o) { return quote{o.price, o.qty}; });
+
+    std::vector<long> probes(row_count);
+    for (auto &p : probes) {
+        p = long(rng() % row_count);
+    }
+
+    std::printf("rows %zu of %zu bytes\n", row_count, sizeof(order));
+
+    double sum = 0;
+    auto plain_find = time_ms([&] {
+        for (auto id : probes) {
+            auto &o = by_id.find(id)->value;
+            sum += o.price * o.qty;
+        }
+    });
+
+    double cover_sum = 0;
+    auto covering_find = time_ms([&] {
+        for (auto id : probes) {
+            auto *q = cover_id.covered(id);
+            cover_sum += q->price * q->qty;
+        }
+    });
+
+    std::printf("point   plain %8.1f ms  covering %8.1f ms  [%s]\n",
+        plain_find, covering_find, sum == cover_sum ? "match" : "MISMATCH");
+
+    sum = cover_sum = 0;
+    auto plain_range = time_ms([&] {
+        for (std::size_t i = 0; i < 2'000; ++i) {
+            auto lo = probes[i] * 4;
+            for (auto r : by_tick.range(lo, lo + range_width)) {
+                sum += r.value.price * r.value.qty;
+            }
+        }
+    });
+
+    auto covering_range = time_ms([&] {
+        for (std::size_t i = 0; i < 2'000; ++i) {
+            auto lo = probes[i] * 4;
+            auto rows = cover_tick.range(lo, lo + range_width);
+            for (auto iter = rows.begin(); iter != rows.end(); ++iter) {
+                cover_sum += iter.covered().price * iter.covered().qty;
+            }
+        }
+    });
+
+    std::printf("range   plain %8.1f ms  covering %8.1f ms  [%s]\n",
+        plain_range, covering_range, sum == cover_sum ? "match" : "MISMATCH");
+}
@@ -0,0 +1,104 @@
+// Index maintenance: indexes created at run time with a std::function key,
+// created at run time with a member pointer key, and declared in the Table type.
+
+#include <memorandum.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace Memorandum;
+
+struct note {
+    long id;
+    long tick;
+    int track;
+    bool operator==(const note &) const = default;
+};
+
+constexpr std::size_t row_count = 500'000;
+
+template<class Fn>
+double time_ms(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+std::vector<note> make_rows() {
+    std::vector<note> rows;
+    rows.reserve(row_count);
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<long> tick(0, 10'000'000);
+    for (std::size_t i = 0; i < row_count; ++i) {
+        rows.push_back({long(i), tick(rng), int(i % 64)});
+    }
+
+    return rows;
+}
+
+template<class T, class Lookup>
+void run(const char *name, T &table, const std::vector<note> &rows, Lookup &&by_id) {
+    std::vector<typename T::oid_type> oids;
+    oids.reserve(rows.size());
+
+    auto insert = time_ms([&] {
+        for (auto const &r : rows) {
+            oids.push_back(table.insert_row(r)->oid);
+        }
+    });
+
+    long sum = 0;
+    auto find = time_ms([&] {
+        for (auto const &r : rows) {
+            sum += by_id(table).find(r.id)->value.tick;
+        }
+    });
+
+    auto erase = time_ms([&] {
+        for (auto oid : oids) {
+            table.delete_row(oid);
+        }
+    });
+
+    std::printf("%-10s insert %8.1f ms  find %8.1f ms  delete %8.1f ms  [%ld]\n",
+        name, insert, find, erase, sum);
+}
+
+int main() {
+    auto rows = make_rows();
+    std::printf("rows %zu, 3 indexes\n", rows.size());
+
+    {
+        Table<note> table;
+        table.create_index<long, hash_storage<>>("id", [](const note &n) { return n.id; });
+        table.create_multi_index<long>("tick", [](const note &n) { return n.tick; });
+        table.create_multi_index<int>("track", [](const note &n) { return n.track; });
+
+        run("run time", table, rows,
+            [](auto &t) -> auto & { return t.template index<long, hash_storage<>>("id"); });
+    }
+
+    {
+        Table<note> table;
+        table.create_index<&note::id, hash_storage<>>("id");
+        table.create_multi_index<&note::tick>("tick");
+        table.create_multi_index<&note::track>("track");
+
+        run("member key", table, rows,
+            [](auto &t) -> auto & { return t.template index<&note::id, hash_storage<>>("id"); });
+    }
+
+    {
+        Table<note,
+            index_on<&note::id, hash_storage<>>,
+            multi_index_on<&note::tick>,
+            multi_index_on<&note::track>> table;
+
+        run("declared", table, rows,
+            [](auto &t) -> auto & { return t.template index<&note::id>(); });
+    }
+}
@@ -0,0 +1,199 @@
+// Compare the index storage backends.
+// The hash backend has no key order, so it has no range time.
+
+#include <memorandum.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+#include <random>
+#include <vector>
+
+using namespace Memorandum;
+
+/*
+ * Count live heap bytes so we can report memory per key.
+ * The allocator knows how big each block is, so the count is of usable
+ * bytes - a little over what was asked for - and nothing is stored in
+ * the blocks themselves.
+ */
+static std::size_t live_bytes = 0;
+
+static void *counted(void *p) {
+    if (not p) throw std::bad_alloc();
+    live_bytes += malloc_usable_size(p);
+    return p;
+}
+
+static void released(void *ptr) noexcept {
+    live_bytes -= malloc_usable_size(ptr);      // 0 for nullptr
+    std::free(ptr);
+}
+
+void *operator new(std::size_t size) {
+    return counted(std::malloc(std::max<std::size_t>(size, 1)));
+}
+
+void operator delete(void *ptr) noexcept { released(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { released(ptr); }
+
+// B+tree internal nodes are cache line aligned.
+void *operator new(std::size_t size, std::align_val_t align) {
+    auto a = std::size_t(align);
+    return counted(std::aligned_alloc(a, (std::max<std::size_t>(size, 1) + a - 1) / a * a));
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept { released(ptr); }
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept { released(ptr); }
+
+constexpr std::size_t key_count = 1'000'000;
+
+template<class Fn>
+double time_ms(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+template<class Storage>
+void run(const char *name, const std::vector<long> &keys) {
+    auto before = live_bytes;
+    auto *storage = new Storage;
+
+    auto insert = time_ms([&] {
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            storage->insert(keys[i], {i});
+        }
+    });
+    auto bytes = live_bytes - before - sizeof(Storage);
+
+    std::size_t found = 0;
+    auto find = time_ms([&] {
+        for (auto k : keys) {
+            found += storage->find(k) != nullptr;
+        }
+    });
+
+    // 1000 windows, each covering about 1000 keys.
+    std::size_t visited = 0;
+    double range = 0;
+    if constexpr (requires { storage->lower_bound(0L); }) {
+        range = time_ms([&] {
+            for (long lo = 0; lo < 1000 * 1000 * 1000L; lo += 1000 * 1000) {
+                auto hi = lo + 1000 * 1000;
+                for (auto iter = storage->lower_bound(lo);
+                        iter != storage->end() and Storage::key_of(iter) < hi; ++iter) {
+                    visited += 1;
+                }
+            }
+        });
+    }
+
+    std::printf("%-18s insert %8.1f ms  find %8.1f ms  range %7.1f ms  %6.1f bytes/key  [%zu %zu]\n",
+        name, insert, find, range, double(bytes) / keys.size(), found, visited);
+
+    delete storage;
+}
+
+struct reading {
+    long sensor;
+    double value;
+
+    bool operator==(const reading &) const = default;
+};
+
+/*
+ * A find() through a Table index, from key to row.
+ */
+template<class Storage>
+void run_table(const char *name, const std::vector<long> &keys) {
+    Table<reading> table;
+    auto &idx = table.create_index<long, Storage>("sensor", [](const reading &r) { return r.sensor; });
+
+    for (auto k : keys) {
+        table.insert_row({k, double(k)});
+    }
+
+    double sum = 0;
+    auto find = time_ms([&] {
+        for (auto k : keys) {
+            auto iter = idx.find(k);
+            if (iter != table.end()) sum += iter->value.value;
+        }
+    });
+
+    std::printf("%-18s table find %8.1f ms  (%.0f ns/lookup)  [%g]\n",
+        name, find, find * 1e6 / keys.size(), sum);
+}
+
+/*
+ * Delete every row of one heavy key from a multi index, oldest first and
+ * in random order. (Newest first only ever removes the last entry.)
+ */
+template<class Storage>
+void run_heavy_delete(const char *name, std::size_t rows) {
+    auto erase = [&](bool shuffled) {
+        Table<reading> table;
+        auto &idx = table.create_multi_index<long, Storage>("sensor", [](const reading &r) { return r.sensor; });
+
+        std::vector<Table<reading>::oid_type> heavy;
+        for (std::size_t i = 0; i < rows; ++i) {
+            heavy.push_back(table.insert_row({42, double(i)})->oid);
+            table.insert_row({long(i) + 100, double(i)});
+        }
+        if (shuffled) {
+            std::shuffle(heavy.begin(), heavy.end(), std::mt19937_64(5));
+        }
+
+        auto ms = time_ms([&] {
+            for (auto oid : heavy) {
+                table.delete_row(oid);
+            }
+        });
+        return std::pair{ms, idx.count()};
+    };
+
+    auto [oldest, left] = erase(false);
+    auto shuffled = erase(true).first;
+
+    std::printf("%-18s delete heavy key  oldest first %8.1f ms  random %8.1f ms  [%zu left]\n",
+        name, oldest, shuffled, left);
+}
+
+int main() {
+    std::vector<long> keys;
+    keys.reserve(key_count);
+
+    std::mt19937_64 rng(3);
+    std::uniform_int_distribution<long> dist(0, 1000 * 1000 * 1000L - 1);
+    for (std::size_t i = 0; i < key_count; ++i) {
+        keys.push_back(dist(rng));
+    }
+
+    std::printf("%zu random keys\n", key_count);
+    run<map_unique_storage<long>>("std::map", keys);
+    run<bptree_unique_storage<long, 16>>("B+tree (16)", keys);
+    run<bptree_unique_storage<long, 64>>("B+tree (64)", keys);
+    run<bptree_unique_storage<long, 128>>("B+tree (128)", keys);
+    run<hash_storage<>::unique<long>>("hash", keys);
+
+    run<map_multi_storage<long>>("std::set multi", keys);
+    run<bptree_multi_storage<long, 64>>("B+tree multi (64)", keys);
+    run<hash_storage<>::multi<long>>("hash multi", keys);
+
+    run_table<map_storage>("std::map", keys);
+    run_table<bptree_storage<>>("B+tree (64)", keys);
+    run_table<hash_storage<>>("hash", keys);
+
+    constexpr std::size_t heavy_rows = 200'000;
+    std::printf("%zu rows with one key\n", heavy_rows);
+    run_heavy_delete<map_storage>("std::map", heavy_rows);
+    run_heavy_delete<bptree_storage<>>("B+tree (64)", heavy_rows);
+    run_heavy_delete<hash_storage<>>("hash", heavy_rows);
+}
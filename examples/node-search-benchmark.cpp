@@ -0,0 +1,89 @@
+// Key search inside BPT::BPlusTree nodes, across fan-outs.
+//
+// long keys take the branchless search (see BPT::branchless_key_search).
+// boxed keys compare exactly the same way, but are not arithmetic, so
+// they take the generic binary search.
+
+#include <bplustree.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+constexpr std::size_t key_count = 1'000'000;
+constexpr std::size_t lookup_count = 2'000'000;
+
+struct boxed {
+    long v = 0;
+
+    friend bool operator<(const boxed &a, const boxed &b) { return a.v < b.v; }
+    friend bool operator==(const boxed &a, const boxed &b) { return a.v == b.v; }
+};
+
+template<class Fn>
+double time_ms(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+template<class Key, std::size_t FanOut>
+double lookups(const std::vector<long> &sorted, const std::vector<long> &probes, std::size_t &found) {
+    using tree_type = BPT::BPlusTree<Key, long, FanOut>;
+
+    std::vector<std::pair<Key, long>> entries;
+    entries.reserve(sorted.size());
+    for (auto k : sorted) {
+        entries.push_back({Key{k}, k});
+    }
+
+    tree_type tree;
+    tree.bulk_load(entries);
+
+    found = 0;
+    return time_ms([&] {
+        for (auto k : probes) {
+            found += tree.contains(Key{k});
+        }
+    });
+}
+
+template<std::size_t FanOut>
+void compare(const std::vector<long> &sorted, const std::vector<long> &probes) {
+    std::size_t found_generic = 0, found_branchless = 0;
+
+    auto generic = lookups<boxed, FanOut>(sorted, probes, found_generic);
+    auto branchless = lookups<long, FanOut>(sorted, probes, found_branchless);
+
+    std::printf("fan out %4zu  binary %7.1f ms  branchless %7.1f ms  %5.2fx  [%zu %zu]\n",
+        FanOut, generic, branchless, generic / branchless, found_generic, found_branchless);
+}
+
+int main() {
+    std::mt19937_64 rng(42);
+
+    std::vector<long> sorted(key_count);
+    for (auto &k : sorted) {
+        k = long(rng() >> 1);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    // Half hits, half misses.
+    std::vector<long> probes(lookup_count);
+    for (std::size_t i = 0; i < probes.size(); ++i) {
+        probes[i] = i % 2 ? sorted[rng() % sorted.size()] : long(rng() >> 1);
+    }
+
+    std::printf("keys %zu, lookups %zu\n", sorted.size(), probes.size());
+
+    compare<8>(sorted, probes);
+    compare<16>(sorted, probes);
+    compare<32>(sorted, probes);
+    compare<64>(sorted, probes);
+    compare<128>(sorted, probes);
+    compare<256>(sorted, probes);
+}
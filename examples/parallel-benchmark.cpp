@@ -0,0 +1,68 @@
+// Single threaded vs parallel scans over a large table.
+
+#include <memorandum.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace Memorandum;
+
+struct note {
+    long tick;
+    int pitch;
+    int velocity;
+    bool operator==(const note &) const = default;
+};
+
+constexpr std::size_t row_count = 4'000'000;
+constexpr int repeats = 10;
+
+template<class Fn>
+double time_ms(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+int main() {
+    Table<note> table;
+    for (std::size_t i = 0; i < row_count; ++i) {
+        table.insert_row({long(i), int(i % 128), int(i % 100)});
+    }
+
+    auto sum = [](long acc, const note &n) { return acc + n.velocity; };
+    auto add = [](long a, long b) { return a + b; };
+    auto pred = [](const note &n) { return n.pitch == 60; };
+
+    long check = 0;
+    auto serial = time_ms([&] {
+        for (int r = 0; r < repeats; ++r) {
+            for (auto iter = table.begin(); iter != table.end(); ++iter) {
+                check += iter->value.velocity;
+            }
+        }
+    }) / repeats;
+    std::printf("rows %zu, serial sum %8.3f ms [%ld]\n", table.count(), serial, check);
+
+    auto hw = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1; threads <= hw; threads *= 2) {
+        long total = 0;
+        auto reduce = time_ms([&] {
+            for (int r = 0; r < repeats; ++r) {
+                total += table.parallel_reduce(0L, sum, add, threads);
+            }
+        }) / repeats;
+
+        std::size_t matches = 0;
+        auto select = time_ms([&] {
+            for (int r = 0; r < repeats; ++r) {
+                matches += table.parallel_select(pred, threads).size();
+            }
+        }) / repeats;
+
+        std::printf("threads %3zu  reduce %8.3f ms  select %8.3f ms  [%ld %zu]\n",
+            threads, reduce, select, total, matches);
+    }
+}
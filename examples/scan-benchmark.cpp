@@ -0,0 +1,95 @@
+// Full table scan throughput at different ratios of deleted rows.
+
+#include <memorandum.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace Memorandum;
+
+struct note {
+    long tick;
+    int pitch;
+    int velocity;
+    bool operator==(const note &) const = default;
+};
+
+constexpr std::size_t row_count = 1'000'000;
+constexpr int repeats = 10;
+
+template<class Fn>
+double time_ms(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+void run(double delete_ratio) {
+    Table<note> table;
+    std::vector<Table<note>::oid_type> oids;
+    oids.reserve(row_count);
+
+    for (std::size_t i = 0; i < row_count; ++i) {
+        oids.push_back(table.insert_row({long(i), int(i % 128), 64})->oid);
+    }
+
+    std::mt19937 rng(42);
+    std::bernoulli_distribution kill(delete_ratio);
+    for (auto oid : oids) {
+        if (kill(rng)) table.delete_row(oid);
+    }
+
+    long sum = 0;
+    auto scan = time_ms([&] {
+        for (int r = 0; r < repeats; ++r) {
+            for (auto iter = table.begin(); iter != table.end(); ++iter) {
+                sum += iter->value.pitch;
+            }
+        }
+    }) / repeats;
+
+    auto select = time_ms([&] {
+        for (int r = 0; r < repeats; ++r) {
+            auto iter = table.select([](const note &n) { return n.pitch == 60; });
+            for (; iter != table.end(); ++iter) {
+                sum += iter->value.velocity;
+            }
+        }
+    }) / repeats;
+
+    // same filter through the type-erased overload.
+    Table<note>::predicate_type erased_pred = [](const note &n) { return n.pitch == 60; };
+    auto erased = time_ms([&] {
+        for (int r = 0; r < repeats; ++r) {
+            auto iter = table.select(erased_pred);
+            for (; iter != table.end(); ++iter) {
+                sum += iter->value.velocity;
+            }
+        }
+    }) / repeats;
+
+    auto batched = time_ms([&] {
+        for (int r = 0; r < repeats; ++r) {
+            table.select_batches([](const note &n) { return n.pitch == 60; },
+                [&](const auto &batch) {
+                    for (auto slot : batch.slots()) {
+                        sum += batch.value(slot).velocity;
+                    }
+                });
+        }
+    }) / repeats;
+
+    auto live = table.count();
+    std::printf("deleted %3.0f%%  live %8zu  scan %8.3f ms (%7.1f Mrows/s)\n"
+                "    select %8.3f ms  std::function select %8.3f ms  batched select %8.3f ms  [%ld]\n",
+        delete_ratio * 100, live, scan, row_count / scan / 1000.0, select, erased, batched, sum);
+}
+
+int main() {
+    for (double ratio : {0.0, 0.1, 0.5, 0.9}) {
+        run(ratio);
+    }
+}
@@ -0,0 +1,87 @@
+// Updating rows: delete and re-insert against update_row, which modifies
+// the row in place and only touches the indexes whose key changed.
+
+#include <memorandum.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace Memorandum;
+
+struct note {
+    long id;
+    long tick;
+    int track;
+    double level;
+    bool operator==(const note &) const = default;
+};
+
+constexpr std::size_t row_count = 500'000;
+
+template<class Fn>
+double time_ms(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+struct fixture {
+    Table<note> table;
+    std::vector<note> rows;
+    std::vector<Table<note>::oid_type> oids;
+
+    fixture() {
+        table.create_index<&note::id, hash_storage<>>("id");
+        table.create_multi_index<&note::tick>("tick");
+        table.create_multi_index<&note::track>("track");
+
+        std::mt19937 rng(3);
+        rows.reserve(row_count);
+        for (std::size_t i = 0; i < row_count; ++i) {
+            rows.push_back({long(i), long(rng() % 10'000'000), int(i % 64), 0.0});
+        }
+        table.insert_rows(rows);
+
+        for (auto r : table) {
+            oids.push_back(r.oid);
+        }
+    }
+};
+
+template<class Change>
+void run(const char *name, Change &&change) {
+    double reinsert, update;
+
+    {
+        fixture f;
+        reinsert = time_ms([&] {
+            for (std::size_t i = 0; i < row_count; ++i) {
+                note n = f.rows[i];
+                change(n);
+                f.table.delete_row(f.oids[i]);
+                f.table.insert_row(n);
+            }
+        });
+    }
+
+    {
+        fixture f;
+        update = time_ms([&] {
+            for (auto oid : f.oids) {
+                f.table.update_row(oid, change);
+            }
+        });
+    }
+
+    std::printf("%-12s delete+insert %8.1f ms  update_row %8.1f ms\n", name, reinsert, update);
+}
+
+int main() {
+    std::printf("rows %zu, 3 indexes\n", row_count);
+
+    run("no key", [](note &n) { n.level += 1.0; });
+    run("one key", [](note &n) { n.tick += 1; });
+}
@@ -3,14 +3,20 @@
 #ifndef _bplustree_include_guard__
 #define _bplustree_include_guard__
 
+#include <algorithm>
 #include <cstddef>
 #include <memory>
 #include <array>
 #include <variant>
-#include <format>
 #include <cassert>
 #include <bitset>
 #include <iterator>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 //#include <iostream>
 
@@ -18,11 +24,19 @@
 namespace BPT {
 /**************************************/
 
-#include "include/_value_wrapper.hpp"
 #include "include/_tree_node.hpp"
 
 constexpr static std::size_t DEFAULT_FAN_OUT = 20;
 
+/*
+ * Leaves hold at least as many entries as an internal node holds keys,
+ * and more when entries are small, so that a leaf spans about as many
+ * bytes as an internal node.
+ */
+template<typename K, class V, std::size_t FO>
+constexpr static std::size_t default_leaf_capacity =
+    std::max<std::size_t>(FO - 1, FO * (sizeof(K) + sizeof(void *)) / (sizeof(K) + sizeof(V)));
+
 template<class Key>
 class set;
 
@@ -32,8 +46,27 @@ concept equal_and_less = requires(T a, T b) {
     {a == b} -> std::convertible_to<bool>;
 };
 
-template<typename K, class V, std::size_t FO = DEFAULT_FAN_OUT>
-requires (FO > 3) && equal_and_less<K>
+/*
+ * Keys that nodes search without branching on comparisons - see
+ * BPlusTree::_rank. Specialize as true for other key types whose < is
+ * cheap and has no side effects.
+ */
+template<class K>
+struct branchless_key_search : std::bool_constant<std::is_arithmetic_v<K>> {};
+
+/*
+ * Keys and values are stored in the leaves themselves, so both must be
+ * default constructible and movable.
+ *
+ * Iterator stability: an iterator (or a pointer or reference to an entry
+ * obtained through one) stays valid until the tree is modified. Any
+ * insert, remove, purge or bulk_load may move entries between slots and
+ * leaves and so invalidates all of them. A lazy remove() only marks the
+ * entry and invalidates nothing.
+ */
+template<typename K, class V, std::size_t FO = DEFAULT_FAN_OUT,
+    std::size_t LC = default_leaf_capacity<K, V, FO>>
+requires (FO > 3) && (LC > 2) && equal_and_less<K>
 class BPlusTree {
 
 public :
@@ -41,55 +74,82 @@ public :
     using key_type = K;
     using mapped_type = V;
     constexpr static std::size_t fan_out = FO;
+    constexpr static std::size_t leaf_capacity = LC;
+
+    using node_type = NodeBase<key_type, fan_out>;
+    using internal_node_type = InternalNode<key_type, fan_out>;
+    using leaf_node_type = LeafNode<key_type, mapped_type, fan_out, leaf_capacity>;
 
-    using value_wrapper_type = ValueWrapper<key_type, mapped_type>;
-    using value_type = typename value_wrapper_type::kvpair;
-    using tree_node_type = TreeNode<key_type, mapped_type, fan_out>;
+    struct value_type {
+        key_type key;
+        mapped_type value;
+    };
 
-    BPlusTree() : root_node_(new tree_node_type(LeafNode)) {
+    /*
+     * What an iterator yields: the key and value of an entry, in place in
+     * its leaf.
+     */
+    struct entry_reference {
+        const key_type &key;
+        mapped_type &value;
+
+        operator value_type() const { return {key, value}; }
+    };
+
+    BPlusTree() : first_leaf_(new leaf_node_type) {
+        root_node_ = last_leaf_ = first_leaf_;
     }
 
-    BPlusTree(BPlusTree &other) : root_node_(new tree_node_type(LeafNode)) {
+    BPlusTree(BPlusTree const &other) : BPlusTree() {
         operator=(other);
     }
 
+    // Bulk load sorted entries - see bulk_load().
+    template<std::input_iterator It, std::sentinel_for<It> S>
+    BPlusTree(It first, S last, double fill_factor = 1.0) : BPlusTree() {
+        bulk_load(first, last, fill_factor);
+    }
+
 
     void swap(BPlusTree &other) {
-        std::swap(root_node_, other.root_node_);
-        std::swap(values_head_, other.values_head_);
-        std::swap(values_tail_, other.values_tail_);
+        _swap_contents(other);
+        std::swap(lazy_removal_, other.lazy_removal_);
     }
 
-    BPlusTree(BPlusTree &&other) : root_node_(new tree_node_type(LeafNode)) {
+    BPlusTree(BPlusTree &&other) : BPlusTree() {
         swap(other);
     }
 
+    // A copy keeps the lazy_removal setting but only the live entries -
+    // the source's tombstones are purged on the way.
     BPlusTree &operator=(BPlusTree const &other) {
-        clear();
-        for (auto const & it : std::as_const(other)) {
-            insert(it.key, it.value);
-        }
+        bulk_load(other.begin(), other.end());
+        lazy_removal_ = other.lazy_removal_;
 
         return *this;
     }
 
     BPlusTree &operator=(BPlusTree &&other) {
         swap(other);
+        return *this;
     }
 
     ~BPlusTree() {
-        _clear_all(true, false);
+        _clear_tree(root_node_, height_);
     }
 
-    tree_node_type *get_root_ptr() const { return root_node_; }
-    value_wrapper_type *get_values() const { return values_head_; }
+    node_type *get_root_ptr() const { return root_node_; }
+    leaf_node_type *get_first_leaf() const { return first_leaf_; }
+
+    // Levels of internal nodes above the leaves - 0 when the root is a leaf.
+    std::size_t height() const { return height_; }
 
     struct FindResults {
         bool found;
-        tree_node_type *node;
+        leaf_node_type *node;
         std::size_t index;
 
-        FindResults(bool f, tree_node_type *ptr, std::size_t i = 0) :
+        FindResults(bool f, leaf_node_type *ptr, std::size_t i = 0) :
             found(f),node(ptr), index(i)
             {}
 
@@ -106,40 +166,35 @@ private:
         using iterator_category = std::input_iterator_tag;
         using difference_type = std::ptrdiff_t;
 
-        // hopefully these works.
-        using value_type = value_type;
-        using value_wrapper_type = value_wrapper_type;
+        using value_type = typename BPlusTree::value_type;
+        using reference = entry_reference;
 
-        using pointer = value_type*;
-        using reference = value_type&;
+        struct arrow_proxy {
+            entry_reference ref;
+            const entry_reference *operator->() const { return &ref; }
+        };
 
-        _iterator_base(value_wrapper_type *ptr) : ptr_{ptr} {
+        using pointer = arrow_proxy;
 
-            while (ptr_ and ptr_->deleted) {
-                if constexpr (REVR)
-                    ptr_ = ptr_->previous;
-                else
-                    ptr_ = ptr_->next;
-            }
+        _iterator_base() = default;
+
+        _iterator_base(leaf_node_type *leaf, std::size_t index) : leaf_{leaf}, index_{index} {
+            settle_();
         }
 
         reference operator*() const {
-            return ptr_->kv;
+            return {leaf_->keys[index_], leaf_->values[index_]};
         }
 
-        pointer operator->() const { return &(ptr_->kv); }
+        pointer operator->() const { return {**this}; }
 
         // Prefix increment
         _iterator_base & operator++() {
             // according to the standard
             // incrementing past the end() is "undefined"
             // So don't bother trying to catch anything.
-            do {
-                if constexpr (REVR)
-                    ptr_ = ptr_->previous;
-                else
-                    ptr_ = ptr_->next;
-            } while(ptr_ and ptr_->deleted );
+            step_();
+            settle_();
 
             return *this;
         }
@@ -148,44 +203,73 @@ private:
         _iterator_base operator++(int) { _iterator_base tmp = *this; ++(*this); return tmp; }
 
 
-        friend bool operator== (const _iterator_base& a, const _iterator_base& b) { return a.ptr_ == b.ptr_; };
-        friend bool operator!= (const _iterator_base& a, const _iterator_base& b) { return a.ptr_ != b.ptr_; };
+        friend bool operator== (const _iterator_base& a, const _iterator_base& b) {
+            return a.leaf_ == b.leaf_ and a.index_ == b.index_;
+        };
 
     private :
-        value_wrapper_type *ptr_;
+        leaf_node_type *leaf_ = nullptr;
+        std::size_t index_ = 0;
 
-    };
-
-    struct const_iterator : _iterator_base<false> {
+        void step_() {
+            if constexpr (REVR) {
+                if (index_ > 0) {
+                    --index_;
+                } else {
+                    leaf_ = leaf_->previous;
+                    index_ = leaf_ and leaf_->num_keys > 0 ? leaf_->num_keys - 1 : 0;
+                }
+            } else {
+                if (++index_ >= leaf_->num_keys) {
+                    leaf_ = leaf_->next;
+                    index_ = 0;
+                }
+            }
+        }
 
-        using iterator_category = std::input_iterator_tag;
-        using difference_type = std::ptrdiff_t;
+        // Move on (if needed) until we are on a live entry, or off the end.
+        void settle_() {
+            while (leaf_) {
+                if (index_ >= leaf_->num_keys) {
+                    // only an empty root leaf, or a position one past a leaf.
+                    if constexpr (REVR) {
+                        if (leaf_->num_keys > 0) {
+                            index_ = leaf_->num_keys - 1;
+                            continue;
+                        }
+                        leaf_ = leaf_->previous;
+                        index_ = leaf_ and leaf_->num_keys > 0 ? leaf_->num_keys - 1 : 0;
+                    } else {
+                        leaf_ = leaf_->next;
+                        index_ = 0;
+                    }
+                } else if (leaf_->deleted[index_]) {
+                    step_();
+                } else {
+                    return;
+                }
+            }
+            index_ = 0;
+        }
 
-        // hopefully these works.
-        using value_type = value_type;
-        using value_wrapper_type = value_wrapper_type;
+    };
 
-        using pointer = value_type const *;
-        using reference = value_type const &;
+    struct const_iterator : _iterator_base<false> {
 
         using _iterator_base<false>::_iterator_base;
 
+        const_iterator & operator++() { _iterator_base<false>::operator++(); return *this; }
+        const_iterator operator++(int) { const_iterator tmp = *this; ++(*this); return tmp; }
+
     };
 
     struct reverse_iterator : _iterator_base<true> {
 
-        using iterator_category = std::input_iterator_tag;
-        using difference_type = std::ptrdiff_t;
-
-        // hopefully these works.
-        using value_type = value_type;
-        using value_wrapper_type = value_wrapper_type;
-
-        using pointer = value_type const *;
-        using reference = value_type const &;
-
         using _iterator_base<true>::_iterator_base;
 
+        reverse_iterator & operator++() { _iterator_base<true>::operator++(); return *this; }
+        reverse_iterator operator++(int) { reverse_iterator tmp = *this; ++(*this); return tmp; }
+
     };
 
     /**************** END of iterators ******************* */
@@ -198,191 +282,341 @@ private:
         return not _is_less(a, b) and not _is_less(b, a);
     }
 
+    // The tree's height says what kind of node a node_type pointer is.
+    static internal_node_type *_as_internal(node_type *node) {
+        return static_cast<internal_node_type *>(node);
+    }
+
+    static leaf_node_type *_as_leaf(node_type *node) {
+        return static_cast<leaf_node_type *>(node);
+    }
+
+    constexpr static bool branchless_search = branchless_key_search<key_type>::value;
+
+    // _rank counts the keys one by one once the range is this short.
+    constexpr static std::size_t rank_window = 16;
+
+    /**********************************
+     * _rank
+     * How many of keys[0, n) are less than key or, with OrEqual, not
+     * greater than it. The range is halved with a conditional move rather
+     * than a branch - the outcome of each comparison is a coin toss, so a
+     * branch mispredicts half the time - and the last few keys are
+     * counted in a loop the compiler vectorizes.
+     **********************************/
+    template<bool OrEqual>
+    static std::size_t _rank(key_type const *keys, std::size_t n, key_type const &key) {
+        auto before = [&key](key_type const &k) -> bool {
+            if constexpr (OrEqual) {
+                return not (key < k);
+            } else {
+                return k < key;
+            }
+        };
+
+        auto const *base = keys;
+        while (n > rank_window) {
+            auto half = n / 2;
+            base = before(base[half - 1]) ? base + half : base;
+            n -= half;
+        }
+
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            count += before(base[i]);
+        }
+
+        return std::size_t(base - keys) + count;
+    }
+
     /**********************************
      * _intranode_leaf_search
-     * For leaf node, we ae only interested in equality.
+     * Index of the first key in the leaf that is not less than key.
      **********************************/
-    int _intranode_leaf_search(key_type const &key, tree_node_type const *node) const {
-        assert(node->is_leaf());
-        int found_index = -1;
+    std::size_t _intranode_leaf_search(key_type const &key, leaf_node_type const *node) const {
+        if constexpr (branchless_search) {
+            return _rank<false>(node->keys.data(), node->num_keys, key);
+        }
 
         std::size_t bottom = 0, top = node->num_keys;
 
-        while(top != bottom) {
-            std::size_t mid = (top + bottom)/2;
+        while (bottom < top) {
+            std::size_t mid = (top + bottom) / 2;
 
-            if (mid == bottom) {
-                if (_equivalent(key,node->keys[mid])) {
-                    found_index = mid;
-                }
-                break;
-            }
-             
-            if (_is_less(key, node->keys[mid])) {
-                top = mid;
-            } else if (_is_less(node->keys[mid], key)) {
-                bottom = mid;
+            if (_is_less(node->keys[mid], key)) {
+                bottom = mid + 1;
             } else {
-                found_index = mid;
-                break;
+                top = mid;
             }
         }
 
-        //std::cout << "_intranode_leaf_search : returning " << found_index << " for " << key << "\n";
-
-        return found_index;
+        return bottom;
     }
 
     /**********************************
      * _intranode_internal_search
-     * For internal node, we need to differenciate between "<" and ">=".
+     * Index of the child to descend into - the first key greater than
+     * key. The "equivalent" pointer is to the right.
      **********************************/
-    int _intranode_internal_search(key_type const &key, tree_node_type const *node) const {
-        assert(node->is_internal());
-
-        int found_index = -1;
+    std::size_t _intranode_internal_search(key_type const &key, internal_node_type const *node) const {
+        if constexpr (branchless_search) {
+            return _rank<true>(node->keys.data(), node->num_keys, key);
+        }
 
         std::size_t bottom = 0, top = node->num_keys;
 
-        while(top != bottom) {
-            std::size_t mid = (top + bottom)/2;
+        while (bottom < top) {
+            std::size_t mid = (top + bottom) / 2;
 
-            if (mid == bottom) {
-                // We've run out of room.
-                if (_is_less(key, node->keys[mid])) {
-                    found_index = mid;
-                } else {
-                    // new key >= to current key
-                    found_index = mid +1;
-                }
-                break;
-            }
-             
             if (_is_less(key, node->keys[mid])) {
                 top = mid;
-            } else if (_is_less(node->keys[mid], key)) {
-                bottom = mid;
             } else {
-                // the "equivalent" pointer is to the right.
-                found_index = mid+1;
-                break;
+                bottom = mid + 1;
             }
         }
 
-        //std::cout << "_intranode_internal_search : returning " << found_index << " for " << key << "\n";
-
-        return found_index;
+        return bottom;
     }
 
 
     /**********************************
      * _find
-     * Returns the leaf the new key should be inserted to.
+     * Returns the leaf the key is in or would be inserted into, and the
+     * index of the first key there not less than key.
      * Note : returns "true" even if the key has been deleted.
      * It is up to the caller to decide if that is good or bad.
      **********************************/
     FindResults _find(key_type const & key) const {
 
-        auto *current_node_ptr = get_root_ptr();
-        bool found = false;
-        int found_index = -1;
+        auto *current_node_ptr = root_node_;
 
-        while (1) {
-            if (current_node_ptr->is_leaf()) {
+        for (auto level = height_; level > 0; --level) {
+            auto *internal = _as_internal(current_node_ptr);
+            current_node_ptr = internal->child_ptrs[_intranode_internal_search(key, internal)];
+        }
 
-                auto retval = _intranode_leaf_search(key, current_node_ptr);
-                if (retval != -1) {
-                    found = true;
-                    found_index = retval;
-                }
-                // We are at a leaf so no further recursion possible.
-                // either we found it in the loop or we did not.
-                break; // out of while-loop
+        auto *leaf = _as_leaf(current_node_ptr);
+        auto index = _intranode_leaf_search(key, leaf);
+        bool found = index < leaf->num_keys and not _is_less(key, leaf->keys[index]);
 
-            } else if (current_node_ptr->is_internal()) {
+        return FindResults(found, leaf, index);
+    }
 
-                auto retval = _intranode_internal_search(key, current_node_ptr);
-                found_index = retval;
-                current_node_ptr = (tree_node_type *)(current_node_ptr->child_ptrs[retval]);
+    /**********************************
+     * _bound
+     * Position of the first key >= key (or > key if upper). The iterator
+     * moves on to the next leaf if the answer is not in this one.
+     **********************************/
+    const_iterator _bound(key_type const & key, bool upper) const {
+        auto results = _find(key);
 
-            } else {
-                throw std::runtime_error(std::format("Unknown node type {}", int(current_node_ptr->ntype)));
-            }
+        auto index = results.index;
+        if (upper and results.found) {
+            index += 1;
         }
 
-        return FindResults(found, current_node_ptr, found_index);
+        return const_iterator{results.node, index};
     }
 
     /**********************************
-     * _clear_all
+     * _clear_tree
      **********************************/
-    void _clear_all(bool clear_values = true, bool new_root = true) {
+    void _clear_tree(node_type *node, std::size_t level) {
 
-        if (new_root == false or root_node_->is_internal() or root_node_->num_keys > 0 ) { 
-            _clear_tree(root_node_);
-            if (new_root) {
-                root_node_ = new tree_node_type(LeafNode);
-            } else {
-                root_node_ = nullptr;
+        if (level > 0) {
+            auto *internal = _as_internal(node);
+            std::size_t max = internal->num_keys;
+            for(std::size_t i = 0; i <= max; ++i) {
+                _clear_tree(internal->child_ptrs[i], level - 1);
             }
+            delete internal;
+        } else {
+            delete _as_leaf(node);
         }
+    }
 
-        if (clear_values and values_head_) {
-            auto *current = values_head_;
-
-            while (current) {
-                auto *next = current->next;
-                delete current;
-                current = next;
-            }
+    void _swap_contents(BPlusTree &other) {
+        std::swap(root_node_, other.root_node_);
+        std::swap(height_, other.height_);
+        std::swap(first_leaf_, other.first_leaf_);
+        std::swap(last_leaf_, other.last_leaf_);
+        std::swap(tombstones_, other.tombstones_);
+    }
 
-            values_head_ = nullptr;
-            values_tail_ = nullptr;
-        }
+    // Bulk load accepts std::pair-like entries and the tree's own value_type.
+    template<class E>
+    static decltype(auto) _entry_key(E &&e) {
+        if constexpr (requires { e.first; }) return (std::forward<E>(e).first);
+        else return (std::forward<E>(e).key);
+    }
 
+    template<class E>
+    static decltype(auto) _entry_value(E &&e) {
+        if constexpr (requires { e.second; }) return (std::forward<E>(e).second);
+        else return (std::forward<E>(e).value);
     }
 
+    /**********************************
+     * _node_count
+     * How many nodes to spread `items` (keys, or children) over so that
+     * each holds about `target`, none holds more than `capacity` and -
+     * unless there is only one - none holds fewer than `minimum`.
+     **********************************/
+    static std::size_t _node_count(std::size_t items, std::size_t target,
+            std::size_t capacity, std::size_t minimum) {
+        std::size_t nodes = (items + target - 1) / target;
+        while (nodes > 1 and items / nodes < minimum) {
+            --nodes;
+        }
+        assert((items + nodes - 1) / nodes <= capacity);
+        return nodes;
+    }
 
     /**********************************
-     * _clear_tree
-     * Only clears the tree structure not the value list.
+     * _build
+     * Make the tree from entries in key order. Leaves are filled left to
+     * right, then each level of internal nodes is built over the one
+     * below it.
      **********************************/
-    void _clear_tree(tree_node_type *node) {
+    void _build(std::vector<value_type> &entries, double fill_factor) {
+        if (entries.empty()) return;
+
+        auto target_for = [&](std::size_t capacity, std::size_t minimum) {
+            auto target = std::size_t(fill_factor * double(capacity) + 0.5);
+            return std::min(capacity, std::max({target, minimum, std::size_t{1}}));
+        };
+
+        auto leaves = _node_count(entries.size(), target_for(leaf_node_type::key_limit, min_leaf_keys),
+            leaf_node_type::key_limit, min_leaf_keys);
+
+        // Every node made so far, so that they can be freed if a key copy
+        // or an allocation throws. There are fewer internal nodes than
+        // leaves, so neither push_back below can reallocate.
+        std::vector<leaf_node_type *> made_leaves;
+        std::vector<internal_node_type *> made_internals;
+        made_leaves.reserve(leaves);
+        made_internals.reserve(leaves);
+
+        try {
+            std::vector<node_type *> level;
+            std::vector<key_type> level_min;
+            level.reserve(leaves);
+            level_min.reserve(leaves);
+
+            std::size_t next = 0;
+            leaf_node_type *previous = nullptr;
+            for (std::size_t n = 0; n < leaves; ++n) {
+                auto *leaf = new leaf_node_type;
+                made_leaves.push_back(leaf);
+                level.push_back(leaf);
+
+                leaf->previous = previous;
+                if (previous) {
+                    previous->next = leaf;
+                }
+                previous = leaf;
 
-        if (node->is_internal()) {
-            int max = node->num_keys;
-            for(int i = 0; i <= max; ++i) {
-                _clear_tree((tree_node_type *)node->child_ptrs[i]);
+                auto count = entries.size() / leaves + (n < entries.size() % leaves);
+                for (std::size_t i = 0; i < count; ++i, ++next) {
+                    leaf->keys[i] = std::move(entries[next].key);
+                    leaf->values[i] = std::move(entries[next].value);
+                }
+                leaf->num_keys = count;
+                level_min.push_back(leaf->keys[0]);
+            }
+
+            std::size_t height = 0;
+            while (level.size() > 1) {
+                auto parents = _node_count(level.size(), target_for(fan_out, min_internal_keys + 1),
+                    fan_out, min_internal_keys + 1);
+
+                std::vector<node_type *> upper;
+                std::vector<key_type> upper_min;
+                upper.reserve(parents);
+                upper_min.reserve(parents);
+
+                next = 0;
+                for (std::size_t n = 0; n < parents; ++n) {
+                    auto *node = new internal_node_type;
+                    made_internals.push_back(node);
+                    upper.push_back(node);
+                    upper_min.push_back(level_min[next]);
+
+                    auto count = level.size() / parents + (n < level.size() % parents);
+                    for (std::size_t i = 0; i < count; ++i, ++next) {
+                        if (i > 0) node->keys[i - 1] = level_min[next];
+                        node->child_ptrs[i] = level[next];
+                        level[next]->parent = node;
+                    }
+                    node->num_keys = count - 1;
+                }
+
+                level = std::move(upper);
+                level_min = std::move(upper_min);
+                height += 1;
             }
+
+            // Nothing below throws - only now give up the old (empty) root.
+            delete _as_leaf(root_node_);
+            root_node_ = level[0];
+            height_ = height;
+            first_leaf_ = made_leaves.front();
+            last_leaf_ = made_leaves.back();
+
+        } catch (...) {
+            for (auto *leaf : made_leaves) delete leaf;
+            for (auto *node : made_internals) delete node;
+            throw;
         }
+    }
 
-        delete node;
+    /**********************************
+     * _insert_into_parent
+     * `new_node` was split off to the right of `node`, and `key` is the
+     * smallest key under it.
+     **********************************/
+    void _insert_into_parent(node_type *node, const key_type &key, node_type *new_node) {
+        if (node->parent) {
+            if (not node->parent->is_full()) {
+                _insert_into_internal(node->parent, key, new_node);
+                new_node->parent = node->parent;
+            } else {
+                _split_internal(node->parent, key, new_node);
+            }
+        } else {
+            // Must be at root, so create fresh node and jam lowest key in new
+            // node into it.
+            auto * new_parent = new internal_node_type;
+
+            new_parent->keys[0] = key;
+            new_parent->child_ptrs[0] = node;
+            new_parent->child_ptrs[1] = new_node;
+            new_parent->num_keys = 1;
+
+            node->parent = new_node->parent = new_parent;
+            root_node_ = new_parent;
+            height_ += 1;
+        }
     }
 
     /**********************************
      * _split_internal
      * Returns the new node that is created.
      **********************************/
-    tree_node_type * _split_internal(tree_node_type *old_node, const key_type &new_key, tree_node_type *new_child ) {
+    internal_node_type * _split_internal(internal_node_type *old_node, const key_type &new_key, node_type *new_child ) {
         assert(old_node != nullptr);
         assert(new_child != nullptr);
-        assert(old_node->is_internal());
         assert(old_node->is_full());
 
-        //std::cout << std::format("_split_internal : start new_key = {}\n", new_key);
-
         std::size_t promoted_index = old_node->key_limit / 2 - 1;
         key_type promoted_key = old_node->keys[promoted_index];
         bool new_key_promoted = false;
-        //std::cout << std::format("_split_internal : (1) promoted_key = {} promoted_index = {}\n", promoted_key, promoted_index);
 
 
         if (_is_less(promoted_key,new_key) ) {
             promoted_index += 1;
             promoted_key = old_node->keys[promoted_index];
 
-            //std::cout << std::format("_split_internal : (2) promoted_key = {} promoted_index = {}\n", promoted_key, promoted_index);
-
             if (_is_less(new_key,promoted_key)) {
                 promoted_key = new_key;
                 new_key_promoted = true;
@@ -390,7 +624,7 @@ private:
 
         }
 
-        auto *new_node = new tree_node_type(old_node->ntype);
+        auto *new_node = new internal_node_type;
 
         // if new_key_promoted then the promoted_index must be copied
         // to the new node.
@@ -400,242 +634,342 @@ private:
         std::size_t new_index = 0;
         std::size_t old_index = copy_min;
 
-        //std::cout << std::format("_split_internal : (3) promoted_key = {} promoted_index = {} copy_min = {}\n", promoted_key, promoted_index, copy_min);
-
 
-        for (; 
-                old_index < old_node->keys.size(); 
+        for (;
+                old_index < old_node->keys.size();
                 ++old_index, ++new_index) {
 
             new_node->keys[new_index] = old_node->keys[old_index];
             new_node->child_ptrs[new_index] = old_node->child_ptrs[old_index];
 
-            ((tree_node_type *)(new_node->child_ptrs[new_index]))->parent = new_node;
+            new_node->child_ptrs[new_index]->parent = new_node;
 
         }
 
         new_node->child_ptrs[new_index] = old_node->child_ptrs[old_index];
-        ((tree_node_type *)(new_node->child_ptrs[new_index]))->parent = new_node;
+        new_node->child_ptrs[new_index]->parent = new_node;
 
-        new_node->num_keys = tree_node_type::key_limit - copy_min;
+        new_node->num_keys = internal_node_type::key_limit - copy_min;
         if (new_key_promoted) {
             old_node->num_keys = copy_min;
 
             new_node->child_ptrs[0] = new_child;
             new_child->parent = new_node;
             // switch back
-            ((tree_node_type *)(old_node->child_ptrs[copy_min]))->parent = old_node;
+            old_node->child_ptrs[copy_min]->parent = old_node;
 
         } else {
             old_node->num_keys = copy_min - 1;
 
             if (_is_less(new_key, promoted_key)) {
-                _insert_into_node(old_node, new_key, new_child);
+                _insert_into_internal(old_node, new_key, new_child);
                 new_child->parent = old_node;
             } else {
-                _insert_into_node(new_node, new_key, new_child);
+                _insert_into_internal(new_node, new_key, new_child);
                 new_child->parent = new_node;
             }
 
         }
-        
-        
-        if (old_node->parent) {
-            if (not old_node->parent->is_full()) {
-                _insert_into_node(old_node->parent, promoted_key, new_node);
-                new_node->parent = old_node->parent;
-            } else {
-                _split_node(old_node->parent, promoted_key, new_node);
-            }
-        } else {
-            // Must be at root, so create fresh node and jam lowest key in new
-            // leaf into it.
-            auto * new_parent = new tree_node_type(InternalNode);
 
-            new_parent->keys[0] = promoted_key;
-            new_parent->child_ptrs[0] = old_node;
-            new_parent->child_ptrs[1] = new_node;
-            new_parent->num_keys = 1;
-
-            old_node->parent = new_node->parent = new_parent;
-            root_node_ = new_parent;
-        }
+        _insert_into_parent(old_node, promoted_key, new_node);
 
         return new_node;
 
     }
 
     /**********************************
-     * _split_node
-     * Returns the new node that is created.
+     * _split_leaf
+     * Move the upper half of a full leaf to a new leaf on its right.
+     * Returns the new leaf.
      **********************************/
-    tree_node_type * _split_node(tree_node_type *old_node, const key_type &new_key, void *child_ptr ) {
-        assert(old_node != nullptr);
-        assert(child_ptr != nullptr);
+    leaf_node_type * _split_leaf(leaf_node_type *old_node) {
+        assert(old_node->is_full());
+
+        auto *new_node = new leaf_node_type;
+
+        // copy over half the key/values from the old leaf
+        std::size_t new_index = 0;
+        const std::size_t split_index = (leaf_node_type::key_limit/2);
+        for (std::size_t old_index = split_index;
+                old_index < leaf_node_type::key_limit;
+                ++old_index, ++new_index) {
+            new_node->keys[new_index] = std::move(old_node->keys[old_index]);
+            new_node->values[new_index] = std::move(old_node->values[old_index]);
+            new_node->deleted[new_index] = old_node->deleted[old_index];
+            old_node->deleted[old_index] = false;
+        }
+
+        new_node->num_keys = leaf_node_type::key_limit - split_index;
+        old_node->num_keys = split_index;
 
-        if (old_node->is_internal()) {
-            return _split_internal(old_node, new_key, reinterpret_cast<tree_node_type *>(child_ptr));
+        new_node->previous = old_node;
+        new_node->next = old_node->next;
+        if (old_node->next) {
+            old_node->next->previous = new_node;
+        } else {
+            last_leaf_ = new_node;
         }
+        old_node->next = new_node;
 
-        //std::cout << "splitting : " << old_node->is_full() << "\n";
+        _insert_into_parent(old_node, new_node->keys[0], new_node);
 
-        auto *new_node = new tree_node_type(old_node->ntype);
+        return new_node;
 
-        // copy over half the key/values from the old leaf
-        int new_index = 0;
-        const int split_index = (tree_node_type::key_limit/2);
-        for (int old_index = split_index; 
-                old_index < tree_node_type::key_limit; 
-                ++old_index, ++new_index) {
-            new_node->keys[new_index] = old_node->keys[old_index];
-            new_node->child_ptrs[new_index] = old_node->child_ptrs[old_index];
+    }
+
+    /**********************************
+     * _insert_into_internal
+     * The new child goes to the right of the new key.
+     **********************************/
+    void _insert_into_internal(internal_node_type *node, key_type const &new_key, node_type *new_child ) {
+        assert(node != nullptr);
+        assert(new_child != nullptr);
+        assert(not node->is_full());
+
+        auto index = _intranode_internal_search(new_key, node);
+
+        for (std::size_t i = node->num_keys; i > index; --i) {
+            node->keys[i] = node->keys[i - 1];
+            node->child_ptrs[i + 1] = node->child_ptrs[i];
         }
 
+        node->keys[index] = new_key;
+        node->child_ptrs[index + 1] = new_child;
+        node->num_keys += 1;
 
-        //std::cout << "copy done\n";
+    }
 
-        new_node->num_keys = tree_node_type::key_limit - split_index;
-        old_node->num_keys = split_index;
+    /**********************************
+     * _insert_into_leaf
+     **********************************/
+    void _insert_into_leaf(leaf_node_type *leaf, std::size_t index, key_type const &key, mapped_type &&value) {
+        assert(not leaf->is_full());
 
+        for (std::size_t i = leaf->num_keys; i > index; --i) {
+            leaf->keys[i] = std::move(leaf->keys[i - 1]);
+            leaf->values[i] = std::move(leaf->values[i - 1]);
+            leaf->deleted[i] = leaf->deleted[i - 1];
+        }
 
-        // need to integrate this into the loop above. this does more shuffling.
+        leaf->keys[index] = key;
+        leaf->values[index] = std::move(value);
+        leaf->deleted[index] = false;
+        leaf->num_keys += 1;
 
-        if (_is_less(new_key, new_node->min_key())) {
-            //std::cout << "split : inserting into old_node\n";
-            _insert_into_node(old_node, new_key, child_ptr);
-        } else {
-            //std::cout << "split : inserting into new_node\n";
-            _insert_into_node(new_node, new_key, child_ptr);
+    }
+
+    /*
+     * Fewest keys a node other than the root may hold after a removal.
+     * Two nodes at or below this always fit in one when merged (with the
+     * separator key from the parent, for internal nodes).
+     */
+    constexpr static std::size_t min_internal_keys = internal_node_type::key_limit / 2;
+    constexpr static std::size_t min_leaf_keys = leaf_node_type::key_limit / 2;
+
+    /**********************************
+     * _child_index
+     * Position of child in its parent's child_ptrs.
+     **********************************/
+    std::size_t _child_index(node_type const *child) const {
+        auto *parent = child->parent;
+        std::size_t index = 0;
+        while (parent->child_ptrs[index] != child) {
+            ++index;
         }
+        return index;
+    }
 
-        if (old_node->parent) {
-            auto min_key = new_node->min_key();
-            if (not old_node->parent->is_full()) {
-                _insert_into_node(old_node->parent, min_key, new_node);
-                new_node->parent = old_node->parent;
-            } else {
-                _split_node(old_node->parent, min_key, new_node);
-            }
-        } else {
-            // Must be at root, so create fresh node and jam lowest key in new
-            // leaf into it.
-            auto * new_parent = new tree_node_type(InternalNode);
+    // Move leaf entry `from` of one leaf to `to` of another (or the same).
+    static void _move_entry(leaf_node_type *dest, std::size_t to, leaf_node_type *src, std::size_t from) {
+        dest->keys[to] = std::move(src->keys[from]);
+        dest->values[to] = std::move(src->values[from]);
+        dest->deleted[to] = src->deleted[from];
+    }
 
-            new_parent->keys[0] = new_node->keys[0];
-            new_parent->child_ptrs[0] = old_node;
-            new_parent->child_ptrs[1] = new_node;
-            new_parent->num_keys = 1;
+    /**********************************
+     * _erase_at
+     * Physically remove entry `index` of a leaf and rebalance the tree.
+     **********************************/
+    void _erase_at(leaf_node_type *leaf, std::size_t index) {
+        assert(index < leaf->num_keys);
 
-            old_node->parent = new_node->parent = new_parent;
-            root_node_ = new_parent;
+        if (leaf->deleted[index]) {
+            tombstones_ -= 1;
         }
 
-        return new_node;
+        for (std::size_t i = index + 1; i < leaf->num_keys; ++i) {
+            _move_entry(leaf, i - 1, leaf, i);
+        }
+        leaf->num_keys -= 1;
+        leaf->deleted[leaf->num_keys] = false;
 
+        if (leaf->parent and leaf->num_keys < min_leaf_keys) {
+            _rebalance_leaf(leaf);
+        }
     }
 
     /**********************************
-     * _insert_into_node
+     * _rebalance_leaf
+     * The leaf has too few keys. Borrow one from a sibling that can
+     * spare it, otherwise merge with a sibling.
      **********************************/
+    void _rebalance_leaf(leaf_node_type *leaf) {
+        auto *parent = leaf->parent;
+        auto index = _child_index(leaf);
 
-    void _insert_into_node(tree_node_type *node, key_type const &new_key, void* new_child ) {
-        assert(node != nullptr);
-        assert(new_child != nullptr);
-        assert(not node->is_full());
+        auto *left = index > 0 ? _as_leaf(parent->child_ptrs[index - 1]) : nullptr;
+        auto *right = index < parent->num_keys ? _as_leaf(parent->child_ptrs[index + 1]) : nullptr;
 
-        //std::cout << "_insert : (" << node->is_full() << "), key = " << new_key << "\n";
+        if (left and left->num_keys > min_leaf_keys) {
+            for (std::size_t i = leaf->num_keys; i > 0; --i) {
+                _move_entry(leaf, i, leaf, i - 1);
+            }
 
-        int insert_index = node->num_keys;
+            auto last = left->num_keys - 1;
+            _move_entry(leaf, 0, left, last);
+            leaf->num_keys += 1;
 
-        auto * keys_ptr = node->keys.data();
-        auto ** child_ptr = node->child_ptrs.data();
+            left->deleted[last] = false;
+            left->num_keys -= 1;
 
-        if (node->is_empty()) {
-            //std::cout << "_insert : node is empty\n";
+            parent->keys[index - 1] = leaf->keys[0];
 
-            // Only happens if this is the first insert into the tree.
-            // the node will be a leaf node.
-            assert(node->is_leaf());
-            assert(values_head_ == nullptr);
+        } else if (right and right->num_keys > min_leaf_keys) {
+            _move_entry(leaf, leaf->num_keys, right, 0);
+            leaf->num_keys += 1;
 
-            child_ptr[0] = new_child;
-            keys_ptr[0] = new_key;
-            node->num_keys = 1;
+            for (std::size_t i = 1; i < right->num_keys; ++i) {
+                _move_entry(right, i - 1, right, i);
+            }
+            right->num_keys -= 1;
+            right->deleted[right->num_keys] = false;
 
-            values_head_ = (value_wrapper_type *)new_child;
-            values_tail_ = values_head_;
-    
-            return;
+            parent->keys[index] = right->keys[0];
 
+        } else if (left) {
+            _merge_leaves(left, leaf, index - 1);
+        } else {
+            _merge_leaves(leaf, right, index);
         }
-        
+    }
 
-        for (int check_index = insert_index-1;
-                insert_index >= 0;
-                --check_index, --insert_index) {
-            
-            //std::cout << std::format("_insert : loop - check_index = {}, insert_index = {}\n", check_index, insert_index);
-            if (check_index < 0 or _is_less(keys_ptr[check_index], new_key) ) {
-                keys_ptr[insert_index] = new_key;
+    /**********************************
+     * _merge_leaves
+     * Move everything in `right` into `left`, then drop `right` and the
+     * parent's separator (at `separator`) between them.
+     **********************************/
+    void _merge_leaves(leaf_node_type *left, leaf_node_type *right, std::size_t separator) {
+        for (std::size_t i = 0; i < right->num_keys; ++i) {
+            _move_entry(left, left->num_keys + i, right, i);
+        }
+        left->num_keys += right->num_keys;
 
-                if (node->is_internal()) {
-                    child_ptr[insert_index+2] = child_ptr[insert_index+1];
-                    child_ptr[insert_index+1] = new_child;
-                } else {
-                    node->deleted[insert_index]  = false;
-                    child_ptr[insert_index] = new_child;
-                    auto *new_value_ptr = (value_wrapper_type *)new_child;
-                    auto ** value_ptr = (value_wrapper_type **)child_ptr;
-                    if (check_index >= 0) {
-                        auto *new_next_ptr = new_value_ptr->next = value_ptr[check_index]->next;
-                        value_ptr[check_index]->next = new_value_ptr;
-
-                        new_value_ptr->previous = value_ptr[check_index];
-                        if (new_next_ptr) {
-                            new_next_ptr->previous = new_value_ptr;
-                        } else {
-                            values_tail_ = new_value_ptr;
-                        }
-                    } else {
-                        // look to the right
-                        new_value_ptr->next = value_ptr[insert_index + 1];
-                        new_value_ptr->previous = value_ptr[insert_index + 1]->previous;
-
-                        if (new_value_ptr->previous == nullptr) {
-                            values_head_ = new_value_ptr;
-                        } else {
-                            new_value_ptr->previous->next = new_value_ptr;
-                        }
+        left->next = right->next;
+        if (right->next) {
+            right->next->previous = left;
+        } else {
+            last_leaf_ = left;
+        }
 
-                        if (new_value_ptr->next == nullptr) {
-                            values_tail_ = new_value_ptr;
-                        } else {
-                            new_value_ptr->next->previous = new_value_ptr;
-                        }
+        delete right;
+        _remove_separator(left->parent, separator);
+    }
 
-                    }
-  
-                }
+    /**********************************
+     * _remove_separator
+     * Remove key `separator` and the child to its right from an internal
+     * node, then deal with the node becoming too small.
+     **********************************/
+    void _remove_separator(internal_node_type *node, std::size_t separator) {
+        for (std::size_t i = separator + 1; i < node->num_keys; ++i) {
+            node->keys[i - 1] = node->keys[i];
+            node->child_ptrs[i] = node->child_ptrs[i + 1];
+        }
+        node->child_ptrs[node->num_keys] = nullptr;
+        node->num_keys -= 1;
+
+        if (node->parent == nullptr) {
+            if (node->num_keys == 0) {
+                // The root has a single child left - it becomes the root.
+                root_node_ = node->child_ptrs[0];
+                root_node_->parent = nullptr;
+                height_ -= 1;
+                delete node;
+            }
+        } else if (node->num_keys < min_internal_keys) {
+            _rebalance_internal(node);
+        }
+    }
 
-                break; // for loop
+    /**********************************
+     * _rebalance_internal
+     * As _rebalance_leaf, but keys rotate through the parent.
+     **********************************/
+    void _rebalance_internal(internal_node_type *node) {
+        auto *parent = node->parent;
+        auto index = _child_index(node);
+
+        auto *left = index > 0 ? _as_internal(parent->child_ptrs[index - 1]) : nullptr;
+        auto *right = index < parent->num_keys ? _as_internal(parent->child_ptrs[index + 1]) : nullptr;
+
+        if (left and left->num_keys > min_internal_keys) {
+            node->child_ptrs[node->num_keys + 1] = node->child_ptrs[node->num_keys];
+            for (std::size_t i = node->num_keys; i > 0; --i) {
+                node->keys[i] = node->keys[i - 1];
+                node->child_ptrs[i] = node->child_ptrs[i - 1];
+            }
 
-            } else {
-                // shove the current resident up one.
-                keys_ptr[insert_index] = keys_ptr[check_index];
+            node->keys[0] = parent->keys[index - 1];
+            node->child_ptrs[0] = left->child_ptrs[left->num_keys];
+            node->child_ptrs[0]->parent = node;
+            node->num_keys += 1;
 
-                if (node->is_internal()) {
-                    child_ptr[insert_index+2] = child_ptr[insert_index+1];
-                } else {
-                    child_ptr[insert_index] = child_ptr[check_index];
-                    node->deleted[insert_index] = node->deleted[check_index];
+            parent->keys[index - 1] = left->keys[left->num_keys - 1];
+            left->child_ptrs[left->num_keys] = nullptr;
+            left->num_keys -= 1;
 
-                }
+        } else if (right and right->num_keys > min_internal_keys) {
+            node->keys[node->num_keys] = parent->keys[index];
+            node->child_ptrs[node->num_keys + 1] = right->child_ptrs[0];
+            node->child_ptrs[node->num_keys + 1]->parent = node;
+            node->num_keys += 1;
+
+            parent->keys[index] = right->keys[0];
+            for (std::size_t i = 1; i < right->num_keys; ++i) {
+                right->keys[i - 1] = right->keys[i];
+            }
+            for (std::size_t i = 1; i <= right->num_keys; ++i) {
+                right->child_ptrs[i - 1] = right->child_ptrs[i];
             }
+            right->child_ptrs[right->num_keys] = nullptr;
+            right->num_keys -= 1;
+
+        } else if (left) {
+            _merge_internal(left, node, index - 1);
+        } else {
+            _merge_internal(node, right, index);
         }
+    }
 
-        //std::cout << "_insert : updating num_keys\n";
-        node->num_keys += 1;
+    /**********************************
+     * _merge_internal
+     * The separator comes down from the parent between the two halves.
+     **********************************/
+    void _merge_internal(internal_node_type *left, internal_node_type *right, std::size_t separator) {
+        auto *parent = left->parent;
 
+        left->keys[left->num_keys] = parent->keys[separator];
+        for (std::size_t i = 0; i < right->num_keys; ++i) {
+            left->keys[left->num_keys + 1 + i] = right->keys[i];
+        }
+        for (std::size_t i = 0; i <= right->num_keys; ++i) {
+            left->child_ptrs[left->num_keys + 1 + i] = right->child_ptrs[i];
+            right->child_ptrs[i]->parent = left;
+        }
+        left->num_keys += right->num_keys + 1;
+
+        delete right;
+        _remove_separator(parent, separator);
     }
 
 public:
@@ -649,62 +983,164 @@ public:
     std::pair<const_iterator, bool> insert(const key_type &key, mapped_type value) {
 
         auto find_results = _find(key);
-
-        //std::cout << "insert : find " << key << "(" << find_results.found << ")\n";
+        auto *leaf_ptr = find_results.node;
+        auto index = find_results.index;
 
         if (find_results.found) {
-            auto * value_ptr = find_results.node->get_value_ptr(find_results.index);
-            if (find_results.node->deleted[find_results.index]) {
+            if (leaf_ptr->deleted[index]) {
                 // deleted - update the value and "undelete"
-                value_ptr->kv.value = value;
-                value_ptr->deleted = false;
-                find_results.node->deleted[find_results.index] = false;
-                return {{value_ptr}, true};
+                leaf_ptr->values[index] = std::move(value);
+                leaf_ptr->deleted[index] = false;
+                tombstones_ -= 1;
+                return {{leaf_ptr, index}, true};
 
             } else {
                 // future to do - support multimap
                 // Support insert_or_assign
-                return {{value_ptr}, false};
+                return {{leaf_ptr, index}, false};
             }
         }
 
-        auto *leaf_ptr = find_results.node;
+        if (leaf_ptr->is_full()) {
+            // At index == num_keys the key still goes at the end of the
+            // old leaf - it is below the separator just promoted.
+            auto *new_leaf = _split_leaf(leaf_ptr);
+            if (index > leaf_ptr->num_keys) {
+                index -= leaf_ptr->num_keys;
+                leaf_ptr = new_leaf;
+            }
+        }
 
-        //std::cout << "insert : just before action\n";
+        _insert_into_leaf(leaf_ptr, index, key, std::move(value));
 
-        auto *value_ptr = new value_wrapper_type(key, value);
+        return {{leaf_ptr, index}, true};
+    }
 
-        if (leaf_ptr->num_keys == tree_node_type::key_limit ) {
-            _split_node(leaf_ptr, key, value_ptr);
-        } else {
-            _insert_into_node(leaf_ptr, key, value_ptr);
+    std::pair<const_iterator, bool> insert(std::pair<key_type, mapped_type> new_pair) {
+        return insert(new_pair.first, std::move(new_pair.second));
+    }
+
+    /**********************************
+     * BULK_LOAD
+     * Replace the contents of the tree with entries - (key, value) pairs
+     * or the value_type of another tree - given in ascending key order.
+     * Of equivalent keys the first wins, as with insert().
+     *
+     * The tree is built bottom up in one pass: no searching, shifting or
+     * splitting. Nodes are filled to fill_factor - more than 0, at most
+     * 1 - of their capacity, but never below what removal keeps them at;
+     * leaving room makes later inserts split less.
+     *
+     * Throws std::invalid_argument if the keys are out of order or
+     * fill_factor is out of range. The tree is left as it was if anything
+     * throws. Returns the number of entries loaded.
+     **********************************/
+    template<std::input_iterator It, std::sentinel_for<It> S>
+    std::size_t bulk_load(It first, S last, double fill_factor = 1.0) {
+        // Also rejects NaN.
+        if (not (fill_factor > 0.0 and fill_factor <= 1.0)) {
+            throw std::invalid_argument("bulk_load: fill_factor must be in (0, 1]");
+        }
+
+        std::vector<value_type> entries;
+
+        if constexpr (std::sized_sentinel_for<S, It>) {
+            entries.reserve(std::size_t(last - first));
+        }
+
+        for (; first != last; ++first) {
+            auto &&entry = *first;
+            auto const &key = _entry_key(entry);
+
+            if (not entries.empty() and not _is_less(entries.back().key, key)) {
+                if (_is_less(key, entries.back().key)) {
+                    throw std::invalid_argument("bulk_load: keys are not in order");
+                }
+                continue;
+            }
 
+            entries.push_back({key, _entry_value(entry)});
         }
 
+        BPlusTree fresh;
+        fresh._build(entries, fill_factor);
+        _swap_contents(fresh);
 
-        return {{value_ptr}, true};
+        return entries.size();
     }
 
-    std::pair<const_iterator, bool> insert(std::pair<key_type, mapped_type> new_pair) {
-        return insert(new_pair.first, new_pair.second);
+    template<std::ranges::input_range R>
+    std::size_t bulk_load(R &&entries, double fill_factor = 1.0) {
+        return bulk_load(std::ranges::begin(entries), std::ranges::end(entries), fill_factor);
     }
 
     /**********************************
      * REMOVE
+     * Normally the entry is removed from its leaf at once. Nodes that
+     * become less than half full borrow from or merge with a sibling,
+     * and the tree loses a level when the root is left with a single
+     * child.
+     *
+     * With lazy removal on, the entry is only marked as deleted - it is
+     * skipped by lookups and iteration, and a later insert of the same
+     * key reuses it. purge() removes the marked entries.
      **********************************/
     bool remove(const key_type &key) {
         auto results = _find(key);
 
-        if (results.found) {
-            if (results.node->deleted[results.index]) {
-                return false;
+        if (not results.found) {
+            return false;
+        }
+
+        bool was_live = not results.node->deleted[results.index];
+
+        if (lazy_removal_) {
+            if (was_live) {
+                results.node->deleted.set(results.index, true);
+                tombstones_ += 1;
+            }
+        } else {
+            _erase_at(results.node, results.index);
+        }
+
+        return was_live;
+    }
+
+    /**********************************
+     * LAZY REMOVAL
+     **********************************/
+    bool lazy_removal() const { return lazy_removal_; }
+
+    // Turning lazy removal off purges the entries already marked.
+    void lazy_removal(bool lazy) {
+        lazy_removal_ = lazy;
+        if (not lazy) {
+            purge();
+        }
+    }
+
+    // Entries marked as deleted but not yet removed.
+    std::size_t tombstones() const { return tombstones_; }
+
+    /**********************************
+     * PURGE
+     * Remove every entry marked by a lazy remove().
+     **********************************/
+    void purge() {
+        if (tombstones_ == 0) return;
+
+        std::vector<key_type> keys;
+        keys.reserve(tombstones_);
+        for (auto *leaf = first_leaf_; leaf; leaf = leaf->next) {
+            for (std::size_t i = 0; i < leaf->num_keys; ++i) {
+                if (leaf->deleted[i]) keys.push_back(leaf->keys[i]);
             }
-            results.node->deleted.set(results.index, true);
-            auto * value_ptr = results.node->get_value_ptr(results.index);
-            value_ptr->deleted = true;
         }
 
-        return results.found;
+        for (auto const &key : keys) {
+            auto results = _find(key);
+            _erase_at(results.node, results.index);
+        }
     }
 
     /*********************************
@@ -714,66 +1150,63 @@ public:
 
         auto results = _find(key);
 
-        if (results.found) {
-            if (results.node->deleted[results.index]) {
-                return cend();
-            } else {
-                auto * value_ptr = (value_wrapper_type *)results.node->child_ptrs[results.index];
-                return const_iterator{value_ptr};
-            }
+        if (results.found and not results.node->deleted[results.index]) {
+            return const_iterator{results.node, results.index};
         }
 
         return cend();
 
     }
     /*********************************
-     * CLEAR
+     * LOWER_BOUND / UPPER_BOUND
+     * First entry with a key not less than (resp. greater than) key.
      *********************************/
-    
-    void clear() {
-        _clear_all();
+    const_iterator lower_bound(const key_type &key) const {
+        return _bound(key, false);
     }
 
-    /*********************************
-     * BEGIN
-     *********************************/
-    //iterator begin() { return iterator(values_head_); }
+    const_iterator upper_bound(const key_type &key) const {
+        return _bound(key, true);
+    }
 
     /*********************************
-     * END
+     * CLEAR
      *********************************/
-    //iterator end() { return iterator(nullptr); }
 
+    void clear() {
+        BPlusTree fresh;
+        _swap_contents(fresh);
+    }
 
     /*********************************
      * CBEGIN
      *********************************/
-    const_iterator cbegin() const { return const_iterator(values_head_); }
-    const_iterator begin() const { return const_iterator(values_head_); }
+    const_iterator cbegin() const { return const_iterator(first_leaf_, 0); }
+    const_iterator begin() const { return const_iterator(first_leaf_, 0); }
 
-    reverse_iterator crbegin() const { return reverse_iterator(values_tail_); }
-    reverse_iterator rbegin() const { return reverse_iterator(values_tail_); }
+    reverse_iterator crbegin() const { return reverse_iterator(last_leaf_, last_leaf_->num_keys); }
+    reverse_iterator rbegin() const { return reverse_iterator(last_leaf_, last_leaf_->num_keys); }
 
     /*********************************
      * CEND
      *********************************/
-    const_iterator cend() const { return const_iterator(nullptr); }
-    const_iterator end() const { return const_iterator(nullptr); }
+    const_iterator cend() const { return const_iterator(nullptr, 0); }
+    const_iterator end() const { return const_iterator(nullptr, 0); }
 
-    reverse_iterator crend() const { return reverse_iterator(nullptr); }
-    reverse_iterator rend() const { return reverse_iterator(nullptr); }
+    reverse_iterator crend() const { return reverse_iterator(nullptr, 0); }
+    reverse_iterator rend() const { return reverse_iterator(nullptr, 0); }
 
     /*********************************
      * COMPUTE_SIZE
-     * 
+     *
      * Adding a size attribute to the tree would create a contention hotspot
      * when we start adding support for concurrency.
      *********************************/
     std::size_t compute_size() const {
         std::size_t size = 0;
 
-        for (auto const & it : *this) {
-            size += 1;
+        for (auto *leaf = first_leaf_; leaf; leaf = leaf->next) {
+            size += leaf->num_keys - leaf->deleted.count();
         }
 
         return size;
@@ -793,18 +1226,21 @@ public:
     mapped_type & at(const key_type &key) {
         auto results = _find(key);
 
-        if (results.found) {
-            auto * value_ptr = (value_wrapper_type *)results.node->child_ptrs[results.index];
-            return value_ptr->kv.value;
+        if (results.found and not results.node->deleted[results.index]) {
+            return results.node->values[results.index];
         } else {
             throw std::out_of_range("Could not find key");
         }
     }
 
 private :
-    tree_node_type* root_node_;
-    value_wrapper_type* values_head_ = nullptr;
-    value_wrapper_type* values_tail_ = nullptr;
+    node_type* root_node_;
+    leaf_node_type* first_leaf_ = nullptr;
+    leaf_node_type* last_leaf_ = nullptr;
+    std::size_t height_ = 0;
+
+    std::size_t tombstones_ = 0;
+    bool lazy_removal_ = false;
 
     friend class set<K>;
 
@@ -812,8 +1248,8 @@ private :
 };
 
 
-template<class K, class V, std::size_t FO>
-void swap(BPlusTree<K, V, FO> &a, BPlusTree<K, V, FO> &b) {
+template<class K, class V, std::size_t FO, std::size_t LC>
+void swap(BPlusTree<K, V, FO, LC> &a, BPlusTree<K, V, FO, LC> &b) {
     a.swap(b);
 }
 
@@ -821,4 +1257,3 @@ void swap(BPlusTree<K, V, FO> &a, BPlusTree<K, V, FO> &b) {
 }
 
 #endif
-
@@ -1,71 +1,68 @@
 #include <cstddef>
 
-enum TreeNodeType {
-    InternalNode,
-    LeafNode
-};
+/*
+ * Nodes are laid out for the search that reads them: the key count and
+ * keys come first. Internal nodes start on a cache line.
+ */
+constexpr static std::size_t NODE_ALIGNMENT = 64;
+
+template<typename K, std::size_t FO>
+struct InternalNode;
+
+/*
+ * What every node has. The tree knows its own height, so it always knows
+ * which kind of node a NodeBase pointer is - there is no type tag.
+ */
+template<typename K, std::size_t FO>
+struct NodeBase {
 
+    std::size_t num_keys = 0;
+    InternalNode<K, FO> *parent = nullptr;
 
-template<typename K, typename V, std::size_t FO>
-struct TreeNode {
+    bool is_empty() const { return (num_keys == 0); }
+
+};
+
+/*
+ * FO children, separated by FO-1 keys.
+ */
+template<typename K, std::size_t FO>
+struct alignas(NODE_ALIGNMENT) InternalNode : NodeBase<K, FO> {
 
     using key_type = K;
-    using value_type = V;
-    using value_wrapper_type = ValueWrapper<K, V>;
 
     constexpr static std::size_t fan_out   = FO;
     constexpr static std::size_t key_limit = FO-1;
 
-    using child_ptr_type = void *;
+    using child_ptr_type = NodeBase<K, FO> *;
 
     std::array<key_type, key_limit> keys;
-    std::array<child_ptr_type, fan_out> child_ptrs;
+    std::array<child_ptr_type, fan_out> child_ptrs{};
 
-    // Only used for LeafNodes
-    std::bitset<key_limit> deleted;
+    bool is_full() const { return (this->num_keys >= key_limit); }
 
-    TreeNode *parent = nullptr;   
+};
 
-    std::size_t num_keys = 0;
-    TreeNodeType ntype = InternalNode;
+/*
+ * Leaves hold their entries in place - keys[i] goes with values[i] - and
+ * are linked to the leaves on either side, so the tree can be walked in
+ * key order one leaf at a time.
+ */
+template<typename K, typename V, std::size_t FO, std::size_t LC>
+struct LeafNode : NodeBase<K, FO> {
 
-    TreeNode(TreeNodeType tntype = InternalNode) : ntype(tntype), deleted(0x0) {
+    using key_type = K;
+    using value_type = V;
 
-        for (std::size_t i = 0; i < fan_out; ++i) {
-            child_ptrs[i] = nullptr;
-        }
-    }
+    constexpr static std::size_t key_limit = LC;
 
-    bool is_full() const { return (num_keys >= key_limit); }
-    bool is_empty() const { return (num_keys == 0); }
-    bool is_internal() const { return (ntype == InternalNode); }
-    bool is_leaf() const { return (ntype == LeafNode); }
-
-    value_wrapper_type *get_value_ptr(std::size_t index) {
-        if (is_internal()) {
-            throw std::runtime_error("Not a leaf node");
-        }
-
-        if (index >= num_keys) {
-            throw std::out_of_range("Thats not right");
-        }
-        return (value_wrapper_type *)child_ptrs[index];
-    }
-
-    key_type max_key() const {
-        if (num_keys > 0) {
-            return keys[num_keys - 1];
-        } else {
-            return key_type{};
-        }
-    }
-
-    key_type min_key() const {
-        if (num_keys > 0) {
-            return keys[0];
-        } else {
-            return key_type{};
-        }
-    }
+    std::array<key_type, key_limit> keys;
+    std::array<value_type, key_limit> values;
+    std::bitset<key_limit> deleted;
+
+    LeafNode *previous = nullptr;
+    LeafNode *next = nullptr;
+
+    bool is_full() const { return (this->num_keys >= key_limit); }
 
 };
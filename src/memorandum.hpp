@@ -3,296 +3,2251 @@
 #ifndef _memorandum_include_guard__
 #define _memorandum_include_guard__
 
+#include <algorithm>
+#include <any>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cstddef>
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <span>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
 #include <stdexcept>
 #include <type_traits>
+#include <utility>
+#include <exception>
 #include <functional>
 #include <concepts>
+#include <iterator>
+#include <ranges>
+
+#include "bplustree.hpp"
 
 
 
 namespace Memorandum {
 /**************************************/
 
+/*
+ * How the rows of a bucket are laid out in memory.
+ *
+ * interleaved - each value is stored next to its oid.
+ * split       - oids and values are kept in separate arrays, so a scan
+ *               over the values does not drag the oids through the cache.
+ *
+ * In both cases liveness is a bitmap at the head of the bucket.
+ */
+enum class row_layout {
+    interleaved,
+    split
+};
+
+template<std::size_t RowsPerBucket, row_layout Layout = row_layout::split>
+requires (RowsPerBucket > 0)
+struct bucket_layout {
+    static constexpr std::size_t rows_per_bucket = RowsPerBucket;
+    static constexpr row_layout layout = Layout;
+};
+
+/*
+ * Number of rows whose values fill about `bytes` bytes, rounded down to
+ * a whole 64 bit word of the liveness bitmap.
+ */
+template<class ValueType>
+constexpr std::size_t rows_to_fill(std::size_t bytes) {
+    constexpr std::size_t word = 64;
+    std::size_t rows = bytes / sizeof(ValueType);
+    return rows < word ? word : rows - rows % word;
+}
+
+template<class ValueType, std::size_t PageBytes = 4096, row_layout Layout = row_layout::split>
+using page_sized_layout = bucket_layout<rows_to_fill<ValueType>(PageBytes), Layout>;
+
+template<class ValueType>
+using default_layout = page_sized_layout<ValueType>;
+
+/*
+ * Storage backends for Table indexes.
+ *
+ * A "unique" backend maps each key to a single handle. A "multi" backend
+ * holds any number of (key, handle) entries. Both provide
+ *
+ *   bool insert(key, handle)        - unique: false if the key is taken
+ *   bool erase(key, row)            - only if the entry is for that row
+ *   const handle_type *find(key)    - nullptr if absent
+ *   find(key, row)                  - the entry for that row, or nullptr
+ *   insert_sorted(entries)          - a batch of (key, handle), sorted by key
+ *                                     for ordered backends
+ *   equal_range(key)                - every entry with the key
+ *   size(), begin(), end(), key_of(iter), handle_of(iter)
+ *
+ * Ordered backends also provide lower_bound(key) and upper_bound(key).
+ *
+ * Entries hold a Handle: an index_handle, or a type derived from it that
+ * carries more (see covering_handle). `row` is the index_handle of the
+ * row being looked for.
+ *
+ * A storage policy names a unique and a multi backend for any key and
+ * handle type.
+ */
+
+/*
+ * What an index entry refers to: the row's oid and where the row is
+ * stored (its bucket and slot in the owning Table), so an index hit goes
+ * straight to the row without a trip through the oid directory.
+ *
+ * Handles compare by oid alone. The location is not part of a handle's
+ * identity, which lets the Table update it in place when compaction
+ * moves the row.
+ */
+struct index_handle {
+    std::size_t oid = 0;
+    mutable void *bucket = nullptr;
+    mutable std::uint32_t slot = 0;
+
+    friend bool operator==(const index_handle &a, const index_handle &b) {
+        return a.oid == b.oid;
+    }
+    friend auto operator<=>(const index_handle &a, const index_handle &b) {
+        return a.oid <=> b.oid;
+    }
+};
+
+/*
+ * A handle that also carries a copy of some of the row's fields, so a
+ * covering index can answer a query without touching the table. Like the
+ * location, the copy is not part of the handle's identity and is
+ * refreshed in place when the row is updated.
+ */
+template<class Projection>
+struct covering_handle : index_handle {
+    mutable Projection covered{};
+};
+
+// A Handle for `row` with everything else defaulted, for lookups.
+template<class Handle>
+Handle _probe_handle(const index_handle &row) {
+    Handle h{};
+    static_cast<index_handle &>(h) = row;
+    return h;
+}
+
+template<class Key, class Handle = index_handle>
+class map_unique_storage {
+    std::map<Key, Handle> map_;
+
+public :
+    using key_type = Key;
+    using handle_type = Handle;
+    using const_iterator = typename std::map<Key, handle_type>::const_iterator;
+
+    bool insert(const key_type &key, handle_type handle) {
+        return map_.emplace(key, std::move(handle)).second;
+    }
+
+    bool erase(const key_type &key, const index_handle &row) {
+        auto iter = map_.find(key);
+        if (iter == map_.end() or iter->second != row) return false;
+
+        map_.erase(iter);
+        return true;
+    }
+
+    const handle_type *find(const key_type &key) const {
+        auto iter = map_.find(key);
+        return iter == map_.end() ? nullptr : &iter->second;
+    }
+
+    const handle_type *find(const key_type &key, const index_handle &row) const {
+        auto iter = map_.find(key);
+        return iter == map_.end() or iter->second != row ? nullptr : &iter->second;
+    }
+
+    // First entry wins on duplicate keys, same as insert().
+    void insert_sorted(std::span<std::pair<key_type, handle_type>> entries) {
+        auto hint = map_.end();
+        for (auto &e : entries) {
+            hint = std::next(map_.emplace_hint(hint, std::move(e.first), std::move(e.second)));
+        }
+    }
+
+    std::size_t size() const { return map_.size(); }
+
+    const_iterator begin() const { return map_.begin(); }
+    const_iterator end() const { return map_.end(); }
+    const_iterator lower_bound(const key_type &key) const { return map_.lower_bound(key); }
+    const_iterator upper_bound(const key_type &key) const { return map_.upper_bound(key); }
+    std::pair<const_iterator, const_iterator> equal_range(const key_type &key) const {
+        return map_.equal_range(key);
+    }
+
+    static const key_type &key_of(const_iterator iter) { return iter->first; }
+    static const handle_type &handle_of(const_iterator iter) { return iter->second; }
+};
+
+/*
+ * Entries are ordered on (key, oid), so removing one row's entry is a
+ * single O(log n) lookup no matter how many rows share its key.
+ */
+template<class Key, class Handle = index_handle>
+class map_multi_storage {
+    using entry_type = std::pair<Key, Handle>;
+
+    // Let lookups skip building an entry.
+    struct _key_probe {
+        const Key &key;
+    };
+
+    struct _row_probe {
+        const Key &key;
+        const index_handle &row;
+    };
+
+    static bool less_(const Key &ak, const index_handle &ar, const Key &bk, const index_handle &br) {
+        return ak < bk or (not (bk < ak) and ar < br);
+    }
+
+    struct _entry_less {
+        using is_transparent = void;
+
+        bool operator()(const entry_type &a, const entry_type &b) const {
+            return less_(a.first, a.second, b.first, b.second);
+        }
+        bool operator()(const entry_type &a, _key_probe b) const { return a.first < b.key; }
+        bool operator()(_key_probe a, const entry_type &b) const { return a.key < b.first; }
+        bool operator()(const entry_type &a, _row_probe b) const {
+            return less_(a.first, a.second, b.key, b.row);
+        }
+        bool operator()(_row_probe a, const entry_type &b) const {
+            return less_(a.key, a.row, b.first, b.second);
+        }
+    };
+
+    std::set<entry_type, _entry_less> set_;
+
+public :
+    using key_type = Key;
+    using handle_type = Handle;
+    using const_iterator = typename std::set<entry_type, _entry_less>::const_iterator;
+
+    bool insert(const key_type &key, handle_type handle) {
+        return set_.emplace(key, std::move(handle)).second;
+    }
+
+    bool erase(const key_type &key, const index_handle &row) {
+        auto iter = set_.find(_row_probe{key, row});
+        if (iter == set_.end()) return false;
+
+        set_.erase(iter);
+        return true;
+    }
+
+    const handle_type *find(const key_type &key) const {
+        auto iter = lower_bound(key);
+        return iter == set_.end() or key < iter->first ? nullptr : &iter->second;
+    }
+
+    const handle_type *find(const key_type &key, const index_handle &row) const {
+        auto iter = set_.find(_row_probe{key, row});
+        return iter == set_.end() ? nullptr : &iter->second;
+    }
+
+    // Within a key the batch is in oid order, so this is the set's order.
+    void insert_sorted(std::span<std::pair<key_type, handle_type>> entries) {
+        auto hint = set_.end();
+        for (auto &e : entries) {
+            hint = std::next(set_.emplace_hint(hint, std::move(e.first), std::move(e.second)));
+        }
+    }
+
+    std::size_t size() const { return set_.size(); }
+
+    const_iterator begin() const { return set_.begin(); }
+    const_iterator end() const { return set_.end(); }
+    const_iterator lower_bound(const key_type &key) const { return set_.lower_bound(_key_probe{key}); }
+    const_iterator upper_bound(const key_type &key) const { return set_.upper_bound(_key_probe{key}); }
+    std::pair<const_iterator, const_iterator> equal_range(const key_type &key) const {
+        return set_.equal_range(_key_probe{key});
+    }
+
+    static const key_type &key_of(const_iterator iter) { return iter->first; }
+    static const handle_type &handle_of(const_iterator iter) { return iter->second; }
+};
+
+template<class Key, std::size_t FanOut, class Handle = index_handle>
+class bptree_unique_storage {
+    using tree_type = BPT::BPlusTree<Key, Handle, FanOut>;
+
+    tree_type tree_;
+    std::size_t size_ = 0;
+
+public :
+    using key_type = Key;
+    using handle_type = Handle;
+    using const_iterator = decltype(std::declval<const tree_type &>().begin());
+
+    bool insert(const key_type &key, handle_type handle) {
+        bool inserted = tree_.insert(key, handle).second;
+        size_ += inserted;
+        return inserted;
+    }
+
+    bool erase(const key_type &key, const index_handle &row) {
+        auto iter = tree_.find(key);
+        if (iter == tree_.end() or iter->value != row) return false;
+
+        tree_.remove(key);
+        size_ -= 1;
+        return true;
+    }
+
+    const handle_type *find(const key_type &key) const {
+        auto iter = tree_.find(key);
+        return iter == tree_.end() ? nullptr : &iter->value;
+    }
+
+    const handle_type *find(const key_type &key, const index_handle &row) const {
+        auto iter = tree_.find(key);
+        return iter == tree_.end() or iter->value != row ? nullptr : &iter->value;
+    }
+
+    // Into an empty tree, the entries are bulk loaded.
+    void insert_sorted(std::span<std::pair<key_type, handle_type>> entries) {
+        if (size_ == 0) {
+            size_ = tree_.bulk_load(entries);
+            return;
+        }
+
+        for (auto &e : entries) {
+            insert(e.first, e.second);
+        }
+    }
+
+    std::size_t size() const { return size_; }
+
+    const_iterator begin() const { return tree_.begin(); }
+    const_iterator end() const { return tree_.end(); }
+    const_iterator lower_bound(const key_type &key) const { return tree_.lower_bound(key); }
+    const_iterator upper_bound(const key_type &key) const { return tree_.upper_bound(key); }
+    std::pair<const_iterator, const_iterator> equal_range(const key_type &key) const {
+        auto first = tree_.find(key);
+        if (first == tree_.end()) return {first, first};
+
+        auto last = first;
+        ++last;
+        return {first, last};
+    }
+
+    static const key_type &key_of(const_iterator iter) { return iter->key; }
+    static const handle_type &handle_of(const_iterator iter) { return iter->value; }
+};
+
+/*
+ * Duplicates are made unique by keying the tree on (key, handle). That also
+ * keeps the rows for one key in oid order.
+ */
+template<class Key, std::size_t FanOut, class Handle = index_handle>
+class bptree_multi_storage {
+    struct _no_value {};
+
+    using entry_type = std::pair<Key, Handle>;
+    using tree_type = BPT::BPlusTree<entry_type, _no_value, FanOut>;
+
+    tree_type tree_;
+    std::size_t size_ = 0;
+
+public :
+    using key_type = Key;
+    using handle_type = Handle;
+    using const_iterator = decltype(std::declval<const tree_type &>().begin());
+
+    bool insert(const key_type &key, handle_type handle) {
+        bool inserted = tree_.insert(entry_type{key, handle}, _no_value{}).second;
+        size_ += inserted;
+        return inserted;
+    }
+
+    bool erase(const key_type &key, const index_handle &row) {
+        bool erased = tree_.remove(entry_type{key, _probe_handle<Handle>(row)});
+        size_ -= erased;
+        return erased;
+    }
+
+    const handle_type *find(const key_type &key) const {
+        auto iter = lower_bound(key);
+        if (iter == end() or not (key_of(iter) == key)) return nullptr;
+
+        return &iter->key.second;
+    }
+
+    const handle_type *find(const key_type &key, const index_handle &row) const {
+        auto iter = tree_.find(entry_type{key, _probe_handle<Handle>(row)});
+        return iter == tree_.end() ? nullptr : &iter->key.second;
+    }
+
+    // Into an empty tree, the entries are bulk loaded.
+    void insert_sorted(std::span<std::pair<key_type, handle_type>> entries) {
+        if (size_ == 0) {
+            size_ = tree_.bulk_load(entries | std::views::transform([](auto &e) {
+                return std::pair{entry_type{std::move(e.first), std::move(e.second)}, _no_value{}};
+            }));
+            return;
+        }
+
+        for (auto &e : entries) {
+            insert(e.first, e.second);
+        }
+    }
+
+    std::size_t size() const { return size_; }
+
+    const_iterator begin() const { return tree_.begin(); }
+    const_iterator end() const { return tree_.end(); }
+    const_iterator lower_bound(const key_type &key) const {
+        return tree_.lower_bound(entry_type{key, _probe_handle<Handle>({0})});
+    }
+    const_iterator upper_bound(const key_type &key) const {
+        return tree_.upper_bound(entry_type{key, _probe_handle<Handle>({~std::size_t{0}})});
+    }
+    std::pair<const_iterator, const_iterator> equal_range(const key_type &key) const {
+        return {lower_bound(key), upper_bound(key)};
+    }
+
+    static const key_type &key_of(const_iterator iter) { return iter->key.first; }
+    static const handle_type &handle_of(const_iterator iter) { return iter->key.second; }
+};
+
+/*
+ * Open addressing with linear probing, for equality-only indexes.
+ *
+ * Entries are stored inline in one array, alongside an array of control
+ * bytes: 0 for an empty slot, otherwise the high bit plus seven bits of
+ * the hash. A probe that runs into a different key is usually rejected
+ * on the control byte alone. Erase shifts the rest of the probe run
+ * back into the hole, so there are no tombstones.
+ *
+ * The multi flavour keeps one entry per distinct key, holding the
+ * handles of its rows in a posting list in oid order. Heavy keys then
+ * cost a single slot. A short list is a sorted vector; past
+ * large_posting_ handles it moves into a BPT::BPlusTree, so adding or
+ * removing a row of a heavy key stays O(log k) in any oid order.
+ *
+ * There is no key order, so lower_bound/upper_bound are not provided and
+ * begin()/end() visit entries in slot order.
+ */
+template<class Key, class Hash, bool Multi, class Handle = index_handle>
+class hash_table_storage {
+    struct _no_value {};
+
+    using posting_tree = BPT::BPlusTree<Handle, _no_value, 32>;
+
+    static constexpr std::size_t large_posting_ = 64;
+
+    // Once large, a posting stays large until its last handle is erased.
+    struct _posting {
+        std::vector<Handle> small;
+        std::unique_ptr<posting_tree> large;
+    };
+
+    using payload_type = std::conditional_t<Multi, _posting, Handle>;
+
+    struct entry_type {
+        Key key;
+        payload_type payload;
+    };
+
+    union _slot {
+        entry_type entry;
+        _slot() {}
+        ~_slot() {}
+    };
+
+    static constexpr std::size_t min_capacity_ = 16;
+
+    std::unique_ptr<std::uint8_t[]> control_;
+    std::unique_ptr<_slot[]> slots_;
+    std::size_t capacity_ = 0;
+    std::size_t used_ = 0;      // occupied slots
+    std::size_t size_ = 0;      // handles
+    [[no_unique_address]] Hash hash_;
+
+    std::uint64_t hash_of_(const Key &key) const {
+        // Spread the bits - std::hash is the identity for integers.
+        std::uint64_t h = static_cast<std::uint64_t>(hash_(key)) * 0x9E3779B97F4A7C15ull;
+        return h ^ (h >> 29);
+    }
+
+    static std::uint8_t tag_of_(std::uint64_t h) {
+        return static_cast<std::uint8_t>(0x80 | (h >> 57));
+    }
+
+    std::size_t mask_() const { return capacity_ - 1; }
+
+    static const Handle &front_(const entry_type &e) {
+        if constexpr (Multi) {
+            return e.payload.large ? e.payload.large->begin()->key : e.payload.small.front();
+        } else {
+            return e.payload;
+        }
+    }
+
+    static const Handle *posting_find_(const _posting &posting, const index_handle &row) {
+        if (posting.large) {
+            auto iter = posting.large->find(_probe_handle<Handle>(row));
+            return iter == posting.large->end() ? nullptr : &iter->key;
+        }
+
+        auto iter = std::lower_bound(posting.small.begin(), posting.small.end(), row,
+            [](const index_handle &a, const index_handle &b) { return a < b; });
+        return iter != posting.small.end() and *iter == row ? &*iter : nullptr;
+    }
+
+    static bool posting_insert_(_posting &posting, Handle handle) {
+        if (posting.large) {
+            return posting.large->insert(std::move(handle), _no_value{}).second;
+        }
+
+        auto &small = posting.small;
+        if (small.empty() or small.back() < handle) {
+            small.push_back(std::move(handle));
+        } else {
+            auto iter = std::lower_bound(small.begin(), small.end(), handle);
+            if (iter != small.end() and *iter == handle) return false;
+            small.insert(iter, std::move(handle));
+        }
+
+        if (small.size() > large_posting_) {
+            posting.large = std::make_unique<posting_tree>();
+            posting.large->bulk_load(small | std::views::transform([](auto &h) {
+                return std::pair{std::move(h), _no_value{}};
+            }));
+            small = {};
+        }
+        return true;
+    }
+
+    static bool posting_erase_(_posting &posting, const index_handle &row) {
+        if (posting.large) {
+            return posting.large->remove(_probe_handle<Handle>(row));
+        }
+
+        auto *handle = posting_find_(posting, row);
+        if (handle == nullptr) return false;
+
+        posting.small.erase(posting.small.begin() + (handle - posting.small.data()));
+        return true;
+    }
+
+    static bool posting_empty_(const _posting &posting) {
+        return posting.large ? posting.large->begin() == posting.large->end() : posting.small.empty();
+    }
+
+    std::size_t find_slot_(const Key &key) const {
+        if (used_ == 0) return capacity_;
+
+        auto h = hash_of_(key);
+        auto tag = tag_of_(h);
+        for (auto i = h & mask_(); control_[i] != 0; i = (i + 1) & mask_()) {
+            if (control_[i] == tag and slots_[i].entry.key == key) return i;
+        }
+
+        return capacity_;
+    }
+
+    // Caller has made sure there is room.
+    void place_(entry_type &&entry, std::uint64_t h) {
+        auto i = h & mask_();
+        while (control_[i] != 0) {
+            i = (i + 1) & mask_();
+        }
+
+        std::construct_at(&slots_[i].entry, std::move(entry));
+        control_[i] = tag_of_(h);
+        used_ += 1;
+    }
+
+    void remove_slot_(std::size_t i) {
+        std::destroy_at(&slots_[i].entry);
+        control_[i] = 0;
+        used_ -= 1;
+
+        // Pull later members of the probe run back into the hole unless
+        // that would put them in front of their home slot.
+        for (auto j = (i + 1) & mask_(); control_[j] != 0; j = (j + 1) & mask_()) {
+            auto &e = slots_[j].entry;
+            auto home = hash_of_(e.key) & mask_();
+            if (((j - home) & mask_()) < ((j - i) & mask_())) continue;
+
+            std::construct_at(&slots_[i].entry, std::move(e));
+            std::destroy_at(&e);
+            control_[i] = control_[j];
+            control_[j] = 0;
+            i = j;
+        }
+    }
+
+    void rehash_(std::size_t capacity) {
+        auto old_control = std::move(control_);
+        auto old_slots = std::move(slots_);
+        auto old_capacity = capacity_;
+
+        control_ = std::make_unique<std::uint8_t[]>(capacity);
+        slots_ = std::make_unique<_slot[]>(capacity);
+        capacity_ = capacity;
+        used_ = 0;
+
+        for (std::size_t i = 0; i < old_capacity; ++i) {
+            if (old_control[i] == 0) continue;
+
+            auto &e = old_slots[i].entry;
+            auto h = hash_of_(e.key);
+            place_(std::move(e), h);
+            std::destroy_at(&e);
+        }
+    }
+
+    // Keep the load at or below 3/4.
+    void reserve_(std::size_t count) {
+        if (count * 4 <= capacity_ * 3) return;
+
+        auto capacity = std::max(capacity_, min_capacity_);
+        while (count * 4 > capacity * 3) {
+            capacity *= 2;
+        }
+
+        rehash_(capacity);
+    }
+
+public :
+    using key_type = Key;
+    using handle_type = Handle;
+
+    /*
+     * Either visits every handle in slot order, or - from equal_range() -
+     * only the handles of one slot.
+     */
+    class const_iterator {
+        using tree_iterator = std::conditional_t<Multi,
+            decltype(std::declval<const posting_tree &>().begin()), _no_value>;
+
+        const hash_table_storage *storage_ = nullptr;
+        std::size_t slot_ = 0;
+        std::size_t pos_ = 0;           // in a small posting
+        [[no_unique_address]] tree_iterator tree_iter_{};   // in a large one
+        bool one_slot_ = false;
+
+        const entry_type &entry_() const { return storage_->slots_[slot_].entry; }
+
+        void settle_() {
+            while (slot_ < storage_->capacity_ and storage_->control_[slot_] == 0) {
+                ++slot_;
+            }
+            enter_();
+        }
+
+        // Start on the first handle of the current slot.
+        void enter_() {
+            pos_ = 0;
+            if constexpr (Multi) {
+                tree_iter_ = slot_ < storage_->capacity_ and entry_().payload.large
+                    ? entry_().payload.large->begin() : tree_iterator{};
+            }
+        }
+
+        // Step within the current slot. False if it has no more handles.
+        bool step_() {
+            if constexpr (Multi) {
+                auto &posting = entry_().payload;
+                if (posting.large) return ++tree_iter_ != posting.large->end();
+                return ++pos_ < posting.small.size();
+            } else {
+                return false;
+            }
+        }
+
+        const_iterator(const hash_table_storage *storage, std::size_t slot, bool one_slot)
+            : storage_{storage}, slot_{slot}, one_slot_{one_slot} { enter_(); }
+
+        friend class hash_table_storage;
+
+    public :
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = Handle;
+        using pointer = const Handle *;
+        using reference = const Handle &;
+
+        const_iterator() = default;
+        const_iterator(const hash_table_storage *storage, std::size_t slot)
+            : storage_{storage}, slot_{slot} { settle_(); }
+
+        const key_type &key() const { return storage_->slots_[slot_].entry.key; }
+
+        reference operator*() const {
+            if constexpr (Multi) {
+                auto &posting = entry_().payload;
+                return posting.large ? tree_iter_->key : posting.small[pos_];
+            } else {
+                return entry_().payload;
+            }
+        }
+        pointer operator->() const { return &**this; }
+
+        const_iterator &operator++() {
+            if (step_()) return *this;
+
+            if (one_slot_) {
+                slot_ = storage_->capacity_;
+                enter_();
+            } else {
+                ++slot_;
+                settle_();
+            }
+            return *this;
+        }
+        const_iterator operator++(int) { auto tmp = *this; ++*this; return tmp; }
+
+        bool operator==(const const_iterator &o) const {
+            if constexpr (Multi) {
+                if (not (tree_iter_ == o.tree_iter_)) return false;
+            }
+            return slot_ == o.slot_ and pos_ == o.pos_;
+        }
+    };
+
+    hash_table_storage() = default;
+    hash_table_storage(const hash_table_storage &) = delete;
+    hash_table_storage &operator=(const hash_table_storage &) = delete;
+
+    ~hash_table_storage() {
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            if (control_[i] != 0) std::destroy_at(&slots_[i].entry);
+        }
+    }
+
+    bool insert(const key_type &key, handle_type handle) {
+        auto i = find_slot_(key);
+        if (i != capacity_) {
+            if constexpr (Multi) {
+                if (not posting_insert_(slots_[i].entry.payload, std::move(handle))) return false;
+                size_ += 1;
+                return true;
+            } else {
+                return false;
+            }
+        }
+
+        reserve_(used_ + 1);
+        if constexpr (Multi) {
+            place_(entry_type{key, {{std::move(handle)}, nullptr}}, hash_of_(key));
+        } else {
+            place_(entry_type{key, std::move(handle)}, hash_of_(key));
+        }
+        size_ += 1;
+        return true;
+    }
+
+    bool erase(const key_type &key, const index_handle &row) {
+        auto i = find_slot_(key);
+        if (i == capacity_) return false;
+
+        if constexpr (Multi) {
+            auto &posting = slots_[i].entry.payload;
+            if (not posting_erase_(posting, row)) return false;
+
+            if (not posting_empty_(posting)) {
+                size_ -= 1;
+                return true;
+            }
+        } else {
+            if (slots_[i].entry.payload != row) return false;
+        }
+
+        remove_slot_(i);
+        size_ -= 1;
+        return true;
+    }
+
+    const handle_type *find(const key_type &key) const {
+        auto i = find_slot_(key);
+        return i == capacity_ ? nullptr : &front_(slots_[i].entry);
+    }
+
+    const handle_type *find(const key_type &key, const index_handle &row) const {
+        auto i = find_slot_(key);
+        if (i == capacity_) return nullptr;
+
+        if constexpr (Multi) {
+            return posting_find_(slots_[i].entry.payload, row);
+        } else {
+            return slots_[i].entry.payload == row ? &slots_[i].entry.payload : nullptr;
+        }
+    }
+
+    // The batch is not sorted - keys need not have an order. Each entry
+    // of a unique table takes a slot, so make room up front. A multi
+    // table grows as it goes instead; a heavy key would over-reserve.
+    void insert_sorted(std::span<std::pair<key_type, handle_type>> entries) {
+        if constexpr (not Multi) {
+            reserve_(used_ + entries.size());
+        }
+
+        for (auto &e : entries) {
+            insert(e.first, std::move(e.second));
+        }
+    }
+
+    std::size_t size() const { return size_; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, capacity_); }
+
+    std::pair<const_iterator, const_iterator> equal_range(const key_type &key) const {
+        auto i = find_slot_(key);
+        if (i == capacity_) return {end(), end()};
+
+        return {const_iterator(this, i, true), end()};
+    }
+
+    static const key_type &key_of(const_iterator iter) { return iter.key(); }
+    static const handle_type &handle_of(const_iterator iter) { return *iter; }
+};
+
+template<class Storage>
+concept ordered_index_storage = requires(const Storage &s, const typename Storage::key_type &key) {
+    { s.lower_bound(key) } -> std::same_as<typename Storage::const_iterator>;
+    { s.upper_bound(key) } -> std::same_as<typename Storage::const_iterator>;
+};
+
+struct map_storage {
+    template<class Key, class Handle = index_handle>
+    using unique = map_unique_storage<Key, Handle>;
+    template<class Key, class Handle = index_handle>
+    using multi = map_multi_storage<Key, Handle>;
+};
+
+template<std::size_t FanOut = 64>
+struct bptree_storage {
+    template<class Key, class Handle = index_handle>
+    using unique = bptree_unique_storage<Key, FanOut, Handle>;
+    template<class Key, class Handle = index_handle>
+    using multi = bptree_multi_storage<Key, FanOut, Handle>;
+};
+
+/*
+ * Hash defaults to std::hash<Key>.
+ */
+template<class Hash = void>
+struct hash_storage {
+    template<class Key>
+    using hasher = std::conditional_t<std::is_void_v<Hash>, std::hash<Key>, Hash>;
+
+    template<class Key, class Handle = index_handle>
+    using unique = hash_table_storage<Key, hasher<Key>, false, Handle>;
+    template<class Key, class Handle = index_handle>
+    using multi = hash_table_storage<Key, hasher<Key>, true, Handle>;
+};
+
+using default_index_storage = bptree_storage<>;
+
+/*
+ * Indexes can also be declared as part of the Table type:
+ *
+ *   Table<employee, index_on<&employee::id>, multi_index_on<&employee::dept>>
+ *
+ * Key is anything std::invoke can call with a row: a pointer to a data
+ * member, a pointer to a const member function, or a captureless lambda.
+ * Declared indexes live as long as the table, are kept up to date
+ * without virtual calls, and are retrieved by key with
+ * table.index<&employee::id>().
+ */
+template<auto Key, class Storage = default_index_storage>
+struct index_on {
+    static constexpr auto key = Key;
+    static constexpr bool is_multi = false;
+    using storage_policy = Storage;
+};
+
+template<auto Key, class Storage = default_index_storage>
+struct multi_index_on {
+    static constexpr auto key = Key;
+    static constexpr bool is_multi = true;
+    using storage_policy = Storage;
+};
+
+// Computes an index key by calling Key on a row. Two declarations use
+// the same key exactly when their _row_key types are the same.
+template<auto Key>
+struct _row_key {
+    template<class ValueType>
+    decltype(auto) operator()(const ValueType &v) const { return std::invoke(Key, v); }
+};
+
+template<class T>
+concept _layout_option = requires {
+    { T::rows_per_bucket } -> std::convertible_to<std::size_t>;
+    { T::layout } -> std::convertible_to<row_layout>;
+};
+
+template<class T>
+concept _index_option = requires {
+    T::key;
+    { T::is_multi } -> std::convertible_to<bool>;
+    typename T::storage_policy;
+};
+
+// The layout named in a Table's options, or the default.
+template<class ValueType, class... Options>
+struct _table_layout {
+    using type = default_layout<ValueType>;
+};
+
+template<class ValueType, class First, class... Rest>
+struct _table_layout<ValueType, First, Rest...> :
+    std::conditional_t<_layout_option<First>,
+        std::type_identity<First>, _table_layout<ValueType, Rest...>> {};
+
+// Position of the declaration for Key among the Decls.
+template<auto Key, class... Decls>
+constexpr std::size_t _index_position() {
+    std::size_t pos = 0;
+    bool found = ((std::is_same_v<_row_key<Decls::key>, _row_key<Key>> ? true : (++pos, false)) or ...);
+    return found ? pos : sizeof...(Decls);
+}
+
+
+
+/*
+ * Options is any mix of at most one layout (see bucket_layout) and any
+ * number of index declarations (see index_on).
+ */
+template<class ValueType, class... Options>
+requires requires(ValueType a, ValueType b) {
+    { a == b } -> std::convertible_to<bool>;
+}
+class Table {
+    static_assert(((_layout_option<Options> or _index_option<Options>) and ...),
+        "Table options must be layouts or index declarations");
+    static_assert((std::size_t{_layout_option<Options>} + ... + 0) <= 1,
+        "Table takes at most one layout");
+
+    using Layout = typename _table_layout<ValueType, Options...>::type;
+
+public :
+    using size_type = std::size_t;
+    using oid_type = std::size_t;
+    using layout_type = Layout;
+
+private :
+    static constexpr size_type rows_per_bucket_ = Layout::rows_per_bucket;
+    static constexpr size_type bitmap_words_ = (rows_per_bucket_ + 63) / 64;
+
+public :
+    using value_type = ValueType;
+    using predicate_type = std::function<bool(const value_type&)>;
+
+    struct compaction_stats {
+        size_type buckets_freed = 0;
+        size_type rows_moved = 0;
+        // true once the pass has visited every bucket.
+        bool finished = false;
+    };
+
+    struct bucket_stats {
+        size_type capacity = 0;
+        // slots that have ever held a row (live or deleted).
+        size_type used_slots = 0;
+        size_type live_rows = 0;
+    };
+
+    struct table_stats {
+        size_type buckets = 0;
+        size_type capacity = 0;
+        size_type used_slots = 0;
+        size_type live_rows = 0;
+    };
+
+    // What an iterator refers to.
+    struct row_view {
+        oid_type oid;
+        value_type &value;
+    };
+
+private :
+
+    /****************************************************
+     * Private Structures
+     ****************************************************/
+    #pragma region
+    /*
+     * Values live in raw storage. A value is only constructed while its
+     * slot is live, so unused slots cost nothing and value_type need not
+     * be default constructible. The bucket is responsible for calling
+     * the destructors.
+     */
+    struct _split_rows {
+        std::array<oid_type, rows_per_bucket_> oids;
+        alignas(value_type) std::byte values[rows_per_bucket_ * sizeof(value_type)];
+
+        oid_type &oid(size_type slot) { return oids[slot]; }
+        value_type *value_ptr(size_type slot) {
+            return std::launder(reinterpret_cast<value_type *>(values) + slot);
+        }
+    };
+
+    struct _interleaved_rows {
+        struct _kv {
+            oid_type oid;
+            alignas(value_type) std::byte value[sizeof(value_type)];
+        };
+        std::array<_kv, rows_per_bucket_> kvs;
+
+        oid_type &oid(size_type slot) { return kvs[slot].oid; }
+        value_type *value_ptr(size_type slot) {
+            return std::launder(reinterpret_cast<value_type *>(kvs[slot].value));
+        }
+    };
+
+    using _row_storage = std::conditional_t<Layout::layout == row_layout::split,
+        _split_rows, _interleaved_rows>;
+
+    struct _bucket {
+        _bucket * next = nullptr;
+        _bucket * previous = nullptr;
+
+        // Buckets with at least one deleted slot that can be reused.
+        _bucket * next_free = nullptr;
+        _bucket * previous_free = nullptr;
+        bool on_free_list = false;
+
+        oid_type oid;
+        size_type used_slots = 0;
+        size_type live_slots = 0;
+
+        // bit set == slot holds a live row.
+        std::array<std::uint64_t, bitmap_words_> live{};
+        _row_storage rows;
+
+        _bucket() = default;
+        _bucket(oid_type new_oid) : oid{new_oid} {}
+
+        _bucket(const _bucket &) = delete;
+        _bucket &operator=(const _bucket &) = delete;
+
+        ~_bucket() {
+            if constexpr (not std::is_trivially_destructible_v<value_type>) {
+                for (size_type w = 0; w < bitmap_words_; ++w) {
+                    auto bits = live[w];
+                    while (bits) {
+                        std::destroy_at(rows.value_ptr(w * 64 + std::countr_zero(bits)));
+                        bits &= bits - 1;
+                    }
+                }
+            }
+        }
+
+        friend bool operator==(const _bucket &a, const _bucket &b) {
+            return a.oid == b.oid;
+        }
+        friend auto operator<=>(const _bucket &a, const _bucket &b) {
+            return a.oid <=> b.oid;
+        }
+
+        bool is_empty() const { return live_slots == 0; }
+
+        bool is_live(size_type slot) const {
+            return (live[slot / 64] >> (slot % 64)) & 1u;
+        }
+        void set_live(size_type slot) {
+            live[slot / 64] |= std::uint64_t{1} << (slot % 64);
+        }
+        void clear_live(size_type slot) {
+            live[slot / 64] &= ~(std::uint64_t{1} << (slot % 64));
+        }
+
+        // First live slot at or after `slot`; rows_per_bucket_ if none.
+        size_type next_live(size_type slot) const {
+            size_type w = slot / 64;
+            if (w >= bitmap_words_) return rows_per_bucket_;
+
+            auto bits = live[w] & (~std::uint64_t{0} << (slot % 64));
+            while (bits == 0) {
+                if (++w == bitmap_words_) return rows_per_bucket_;
+                bits = live[w];
+            }
+
+            return w * 64 + std::countr_zero(bits);
+        }
+
+        oid_type &oid_at(size_type slot) { return rows.oid(slot); }
+        value_type &value_at(size_type slot) { return *rows.value_ptr(slot); }
+
+        template<class... Args>
+        void construct_at(size_type slot, Args &&... args) {
+            std::construct_at(rows.value_ptr(slot), std::forward<Args>(args)...);
+        }
+        void destroy_at(size_type slot) {
+            std::destroy_at(rows.value_ptr(slot));
+        }
+
+        size_type find_free_slot() const {
+            for (size_type w = 0; w < bitmap_words_; ++w) {
+                auto holes = ~live[w];
+                if (holes) {
+                    auto slot = w * 64 + std::countr_zero(holes);
+                    return slot < used_slots ? slot : used_slots;
+                }
+            }
+
+            return used_slots;
+        }
+    };
+
+    struct _all_rows {
+        constexpr bool operator()(const value_type &) const { return true; }
+    };
+
+    // Lambdas that capture can be copied but not assigned. This keeps
+    // iterators holding them assignable.
+    template<class Pred>
+    struct _predicate_box {
+        Pred pred;
+
+        _predicate_box(Pred p) : pred(std::move(p)) {}
+        _predicate_box(const _predicate_box &) = default;
+
+        _predicate_box &operator=(const _predicate_box &other) {
+            if constexpr (std::is_copy_assignable_v<Pred>) {
+                pred = other.pred;
+            } else if (this != &other) {
+                std::destroy_at(&pred);
+                std::construct_at(&pred, other.pred);
+            }
+            return *this;
+        }
+    };
+
+    /*
+     * The predicate is part of the iterator type so that it can be
+     * inlined. select(predicate_type) gives the type-erased version.
+     */
+    template<class Pred>
+    struct _scan_iterator {
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+
+        using value_type = Table::value_type;
+
+        using pointer = value_type*;
+        using reference = value_type&;
+
+        struct arrow_proxy {
+            row_view view;
+            const row_view *operator->() const { return &view; }
+        };
+
+        _scan_iterator(_bucket * ptr,
+            size_type slot,
+            Pred pred = Pred{}) : ptr_{ptr}, slot_{slot}, predicate_{std::move(pred)} {
+            if (ptr_) {
+                word_ = slot_ / 64;
+                bits_ = word_ < bitmap_words_ ?
+                    ptr_->live[word_] & (~std::uint64_t{0} << (slot_ % 64)) : 0;
+            }
+            settle_();
+        }
+
+        row_view operator*() const {
+            return {ptr_->oid_at(slot_), ptr_->value_at(slot_)};
+        }
+
+        arrow_proxy operator->() const { return {operator*()}; }
+
+        // Prefix increment
+        _scan_iterator & operator++() {
+            // according to the standard
+            // incrementing past the end() is "undefined"
+            // So don't bother trying to catch anything.
+            bits_ &= bits_ - 1;
+            settle_();
+
+            return *this;
+        }
+
+        // Postfix increment
+        _scan_iterator operator++(int) { _scan_iterator tmp = *this; ++(*this); return tmp; }
+
+
+        friend bool operator== (const _scan_iterator& a, const _scan_iterator& b) {
+            return a.ptr_ == b.ptr_ and a.slot_ == b.slot_;
+        };
+
+        // Allow comparing a select() against end().
+        template<class OtherPred>
+        bool operator== (const _scan_iterator<OtherPred>& other) const {
+            return ptr_ == other.ptr_ and slot_ == other.slot_;
+        };
+
+    private :
+        template<class> friend struct _scan_iterator;
+        friend class Table;
+
+        _bucket * ptr_;
+        size_type slot_ = 0;
+        _predicate_box<Pred> predicate_;
+
+        // The live bits of liveness word `word_` not yet visited. The
+        // lowest set bit is the current slot.
+        size_type word_ = 0;
+        std::uint64_t bits_ = 0;
+
+        // Move forward (if needed) until we are sitting on a live row
+        // that satisfies the predicate, or have fallen off the end.
+        // Dead rows are skipped a bitmap word at a time, and buckets
+        // with no live rows are not looked into at all.
+        void settle_() {
+            while (ptr_) {
+                while (1) {
+                    if (bits_) {
+                        slot_ = word_ * 64 + std::countr_zero(bits_);
+                        if (predicate_.pred(ptr_->value_at(slot_))) {
+                            return;
+                        }
+                        bits_ &= bits_ - 1;
+                    } else if (++word_ < bitmap_words_) {
+                        bits_ = ptr_->live[word_];
+                    } else {
+                        break;
+                    }
+                }
+
+                do {
+                    ptr_ = ptr_->next;
+                } while (ptr_ and ptr_->is_empty());
+
+                if (ptr_) {
+                    word_ = 0;
+                    bits_ = ptr_->live[0];
+                }
+            }
+
+            slot_ = rows_per_bucket_ + 1;
+        }
+
+    };
+
+public :
+    using iterator = _scan_iterator<_all_rows>;
+    using predicate_iterator = _scan_iterator<predicate_type>;
+
+    using slot_type = std::uint32_t;
+
+    /*
+     * The rows of one bucket that matched a batch filter.
+     * mask() has a bit set for each matching slot, slots() lists the
+     * same slots in ascending order.
+     */
+    class row_batch {
+    public :
+        size_type size() const { return slots_.size(); }
+        bool empty() const { return slots_.empty(); }
+
+        row_view operator[](size_type i) const {
+            auto slot = slots_[i];
+            return {bucket_->oid_at(slot), bucket_->value_at(slot)};
+        }
+
+        std::span<const slot_type> slots() const { return slots_; }
+        std::span<const std::uint64_t> mask() const { return mask_; }
+
+        oid_type oid(slot_type slot) const { return bucket_->oid_at(slot); }
+        value_type &value(slot_type slot) const { return bucket_->value_at(slot); }
+
+    private :
+        friend class Table;
+
+        row_batch(_bucket *b, std::span<const std::uint64_t> m, std::span<const slot_type> s) :
+            bucket_{b}, mask_{m}, slots_{s} {}
 
-template<class ValueType>
-requires requires(ValueType a, ValueType b) {
-    { a == b } -> std::convertible_to<bool>;
-}
-class Table {
+        _bucket * bucket_;
+        std::span<const std::uint64_t> mask_;
+        std::span<const slot_type> slots_;
+    };
 
-    using size_type = std::size_t;
-    using oid_type = std::size_t;
+private :
 
-    static constexpr size_type rows_per_bucket_ = 100;
+    struct _batch_row {
+        index_handle handle;
+        const value_type *value;
+    };
 
-public :
-    using value_type = ValueType;
-    using predicate_type = std::function<bool(const value_type&)>;
+    // The Projector of an index that stores nothing beyond the handle.
+    struct _no_projection {};
 
-private :
+    struct _index_base {
+
+        virtual ~_index_base() = default;
+
+        virtual void add(index_handle row, const ValueType &v) = 0;
+        virtual void remove(index_handle row, const ValueType &v)  = 0;
+
+        // The row has been moved to the location in `row`.
+        virtual void relink(index_handle row, const ValueType &v) = 0;
+
+        // Called with the row's value before and after it is modified in
+        // place. Only an index whose key changed touches its storage.
+        // What before_update returns is handed back to after_update, so
+        // the index itself holds no state between the two.
+        virtual std::any before_update(const ValueType &v) = 0;
+        virtual void after_update(index_handle row, const ValueType &v, std::any &old) = 0;
+
+        // Rows arrive in oid order.
+        virtual void add_batch(std::span<const _batch_row> rows) {
+            for (auto const &r : rows) {
+                add(r.handle, *r.value);
+            }
+        }
+    };
+
+    struct _row_ref {
+        _bucket * ptr = nullptr;
+        size_type slot = 0;
+
+        _row_ref() = default;
+        _row_ref(_bucket * p, size_type s) : ptr{p}, slot{s} {}
+
+        value_type &value() {
+            return ptr->value_at(slot);
+        }
+
+    };
+
+    /*
+     * Maps an oid to the location of its row.
+     *
+     * OIDs come from a monotonically increasing counter, so rather than a
+     * tree we keep a paged array indexed directly by oid. A lookup is two
+     * array indexings and no row costs an allocation of its own. A page is
+     * released as soon as the last row it references is deleted, so the
+     * directory stays proportional to the live rows rather than to every
+     * oid ever handed out.
+     */
+    struct _oid_directory {
+        static constexpr size_type page_bits = 10;
+        static constexpr size_type page_size = size_type{1} << page_bits;
+        static constexpr size_type page_mask = page_size - 1;
+
+        struct _page {
+            std::array<_row_ref, page_size> entries;
+            size_type live = 0;
+        };
+
+        _row_ref * find(oid_type oid) {
+            auto page_num = oid >> page_bits;
+            if (page_num >= pages_.size() or not pages_[page_num]) {
+                return nullptr;
+            }
+
+            auto &entry = pages_[page_num]->entries[oid & page_mask];
+            return entry.ptr ? &entry : nullptr;
+        }
+
+        void insert(oid_type oid, _row_ref ref) {
+            auto page_num = oid >> page_bits;
+            if (page_num >= pages_.size()) {
+                pages_.resize(page_num + 1);
+            }
+
+            auto &page = pages_[page_num];
+            if (not page) {
+                page = std::make_unique<_page>();
+            }
+
+            page->entries[oid & page_mask] = ref;
+            page->live += 1;
+        }
+
+        void reserve(oid_type last_oid) {
+            pages_.reserve((last_oid >> page_bits) + 1);
+        }
+
+        void erase(oid_type oid) {
+            auto page_num = oid >> page_bits;
+            auto &page = pages_[page_num];
+
+            page->entries[oid & page_mask] = _row_ref{};
+            page->live -= 1;
+            if (page->live == 0) {
+                page.reset();
+            }
+        }
+
+    private :
+        std::vector<std::unique_ptr<_page>> pages_;
+    };
+
+    struct _index_ref {
+        _index_base *idx;
+        bool is_multi;
+
+        _index_ref(_index_base *i, bool m) : idx{i}, is_multi{m} {}
+    };
+
+#pragma endregion
 
     /****************************************************
-     * Private Structures
+     * Private Data
+     ****************************************************/
+
+    oid_type last_oid_ = 0;
+
+    _bucket * bucket_head_ = nullptr;
+    _bucket * bucket_tail_ = nullptr;
+
+    _bucket * free_head_ = nullptr;
+    _bucket * compact_cursor_ = nullptr;
+    // The last oid handed out when the current compaction pass started.
+    // Buckets are linked in oid order, so the ones added during the pass
+    // - where its relocated rows went - come after every bucket with an
+    // oid up to this, and are left for the next pass.
+    oid_type compact_limit_ = 0;
+
+    // Buckets allocated ahead of time by insert_rows, taken by
+    // add_bucket. Empty outside of insert_rows.
+    std::vector<_bucket *> spare_buckets_;
+
+    size_type bucket_count_ = 0;
+    size_type used_slots_ = 0;
+    size_type live_rows_ = 0;
+
+    _oid_directory row_map_;
+
+    std::map<std::string, _index_ref> index_map_;
+
+
+    /****************************************************
+     * Private Methods
      ****************************************************/
     #pragma region
-    struct _row {
-        struct _kv {
-            oid_type oid;
-            value_type value;
-        } kv;
 
-        bool deleted = false;
+    oid_type get_next_oid() { return ++last_oid_; }
 
-        _row() = default;
-        _row(oid_type o, const value_type &v) : kv{o, v} {}
-    };
+    static index_handle handle_of_(oid_type oid, _row_ref ref) {
+        return {oid, ref.ptr, static_cast<slot_type>(ref.slot)};
+    }
 
-    struct _bucket {
-        _bucket * next = nullptr;
-        _bucket * previous = nullptr;
+    _bucket * add_bucket() {
+        auto oid = get_next_oid();
 
-        oid_type oid;
-        size_type used_slots = 0;
-        std::array<_row, rows_per_bucket_> rows;
+        _bucket * new_bucket;
+        if (spare_buckets_.empty()) {
+            new_bucket = new _bucket(oid);
+        } else {
+            new_bucket = spare_buckets_.back();
+            spare_buckets_.pop_back();
+            new_bucket->oid = oid;
+        }
+        bucket_count_ += 1;
 
-        _bucket() = default;
-        _bucket(oid_type new_oid) : oid{new_oid} {}
+        if (bucket_head_) {
+            bucket_tail_->next = new_bucket;
+            new_bucket->previous = bucket_tail_;
+            bucket_tail_ = new_bucket;
+        } else {
+            bucket_head_ = bucket_tail_ = new_bucket;
+        }
 
-        friend bool operator==(const _bucket &a, const _bucket &b) {
-            return a.oid == a.oid;
+        return new_bucket;
+    }
+
+    void push_free_(_bucket * bucket) {
+        if (bucket->on_free_list) return;
+
+        bucket->on_free_list = true;
+        bucket->previous_free = nullptr;
+        bucket->next_free = free_head_;
+        if (free_head_) {
+            free_head_->previous_free = bucket;
+        }
+        free_head_ = bucket;
+    }
+
+    void unlink_free_(_bucket * bucket) {
+        if (not bucket->on_free_list) return;
+
+        if (bucket->previous_free) {
+            bucket->previous_free->next_free = bucket->next_free;
+        } else {
+            free_head_ = bucket->next_free;
+        }
+        if (bucket->next_free) {
+            bucket->next_free->previous_free = bucket->previous_free;
+        }
+
+        bucket->on_free_list = false;
+        bucket->next_free = bucket->previous_free = nullptr;
+    }
+
+    void free_bucket_(_bucket * bucket) {
+        unlink_free_(bucket);
+
+        if (bucket->previous) {
+            bucket->previous->next = bucket->next;
+        } else {
+            bucket_head_ = bucket->next;
+        }
+        if (bucket->next) {
+            bucket->next->previous = bucket->previous;
+        } else {
+            bucket_tail_ = bucket->previous;
         }
-        friend bool operator<=>(const _bucket &a, const _bucket &b) {
-            return a.oid <=> a.oid;
+
+        if (compact_cursor_ == bucket) {
+            compact_cursor_ = bucket->next;
         }
 
-        bool is_empty() {
-            if (used_slots == 0) return true;
+        bucket_count_ -= 1;
+        used_slots_ -= bucket->used_slots;
+
+        delete bucket;
+    }
 
-            for (int i = 0; i < used_slots; ++i) {
-                if (not rows[i].deleted) return false;
+    // Allocate the buckets that `rows` more rows will need beyond the
+    // free slots the table already has.
+    void reserve_buckets_(size_type rows) {
+        auto room = bucket_count_ * rows_per_bucket_ - live_rows_;
+        if (rows <= room) return;
+
+        auto needed = (rows - room + rows_per_bucket_ - 1) / rows_per_bucket_;
+        spare_buckets_.reserve(needed);
+        try {
+            while (spare_buckets_.size() < needed) {
+                spare_buckets_.push_back(new _bucket);
             }
+        } catch (...) {
+            release_spare_buckets_();
+            throw;
+        }
+    }
 
-            return true;
+    void release_spare_buckets_() {
+        for (auto * bucket : spare_buckets_) {
+            delete bucket;
         }
-    };
+        spare_buckets_.clear();
+    }
 
-    struct iterator {
-        using iterator_category = std::input_iterator_tag;
-        using difference_type = std::ptrdiff_t;
+    // Reuse a deleted slot if there is one, otherwise append.
+    _row_ref claim_slot_() {
+        if (free_head_) {
+            auto * bucket = free_head_;
+            return take_slot_(bucket, bucket->find_free_slot());
+        }
 
-        // hopefully these works.
-        using value_type = value_type;
+        return append_slot_();
+    }
 
-        using iterator_return_type = _row::_kv;
+    _row_ref append_slot_() {
+        _bucket * bucket = bucket_tail_;
+        if (not bucket or bucket->used_slots >= rows_per_bucket_) {
+            bucket = add_bucket();
+        }
 
-        using pointer = value_type*;
-        using reference = value_type&;
+        return take_slot_(bucket, bucket->used_slots);
+    }
 
-        static bool yes(const value_type& b) { return true; }
-        iterator(_bucket * ptr, 
-            size_type slot,
-            predicate_type pred = yes) : ptr_{ptr}, slot_{slot}, predicate_{pred} {
+    _row_ref take_slot_(_bucket * bucket, size_type slot) {
+        if (slot == bucket->used_slots) {
+            bucket->used_slots += 1;
+            used_slots_ += 1;
+        }
+        bucket->live_slots += 1;
+        bucket->set_live(slot);
+        live_rows_ += 1;
+
+        if (bucket->live_slots == bucket->used_slots) {
+            unlink_free_(bucket);
         }
 
-        iterator_return_type & operator*() const {
-            return ptr_->rows[slot_].kv;
+        return {bucket, slot};
+    }
+
+    // Undo take_slot_. The value must already have been destroyed (or
+    // never constructed).
+    void release_slot_(_row_ref ref) {
+        ref.ptr->clear_live(ref.slot);
+        ref.ptr->live_slots -= 1;
+        live_rows_ -= 1;
+        push_free_(ref.ptr);
+    }
+
+    // Construct a new row and enter it in the directory. Indexes are
+    // left to the caller.
+    template<class... Args>
+    _row_ref place_row_(Args &&... args) {
+        auto ref = claim_slot_();
+        try {
+            ref.ptr->construct_at(ref.slot, std::forward<Args>(args)...);
+        } catch (...) {
+            release_slot_(ref);
+            throw;
         }
 
-        iterator_return_type *operator->() const { return &operator*(); }
+        auto oid = get_next_oid();
+        ref.ptr->oid_at(ref.slot) = oid;
+        row_map_.insert(oid, ref);
 
-        // Prefix increment
-        iterator & operator++() {
-            // according to the standard
-            // incrementing past the end() is "undefined"
-            // So don't bother trying to catch anything.
-            slot_ += 1;
-            while (1) {
-                if (slot_ >= ptr_->used_slots) {
-                    ptr_ = ptr_->next;
-                    if (ptr_ == nullptr) {
-                        slot_ = rows_per_bucket_ + 1;
-                        break;
+        return ref;
+    }
+
+    // Move the live rows of a sparse bucket to the end of the table.
+    // Stops early if the budget runs out.
+    size_type evacuate_(_bucket * bucket, size_type budget) {
+        size_type moved = 0;
+
+        // Make sure rows are not moved back into the bucket being emptied.
+        unlink_free_(bucket);
+
+        for (auto i = bucket->next_live(0);
+                i < rows_per_bucket_ and moved < budget;
+                i = bucket->next_live(i + 1)) {
+            auto oid = bucket->oid_at(i);
+            auto target = append_slot_();
+            try {
+                target.ptr->construct_at(target.slot, std::move(bucket->value_at(i)));
+            } catch (...) {
+                release_slot_(target);
+                if (not bucket->is_empty()) push_free_(bucket);
+                throw;
+            }
+            target.ptr->oid_at(target.slot) = oid;
+
+            *row_map_.find(oid) = target;
+            auto handle = handle_of_(oid, target);
+            for_each_declared_([&](auto &idx) { idx.relink_(handle, target.value()); });
+            for (auto &idx : index_map_) {
+                idx.second.idx->relink(handle, target.value());
+            }
+
+            bucket->destroy_at(i);
+            bucket->clear_live(i);
+            bucket->live_slots -= 1;
+            live_rows_ -= 1;
+            moved += 1;
+        }
+
+        if (not bucket->is_empty()) {
+            push_free_(bucket);
+        }
+
+        return moved;
+    }
+
+    /*
+     * Evaluate `pred` over the live rows of a bucket, setting a bit in
+     * `mask` for each match. Fully live words are done in a straight loop
+     * over 64 consecutive values so that simple predicates can be
+     * vectorized; other words only look at their live slots.
+     */
+    template<class Pred>
+    static void filter_bucket_(_bucket * bucket, Pred &pred,
+            std::array<std::uint64_t, bitmap_words_> &mask) {
+
+        for (size_type w = 0; w < bitmap_words_; ++w) {
+            auto live = bucket->live[w];
+            std::uint64_t matches = 0;
+
+            if (live == ~std::uint64_t{0}) {
+                auto base = w * 64;
+                for (size_type i = 0; i < 64; ++i) {
+                    matches |= std::uint64_t(bool(pred(bucket->value_at(base + i)))) << i;
+                }
+            } else {
+                while (live) {
+                    auto bit = std::countr_zero(live);
+                    if (pred(bucket->value_at(w * 64 + bit))) {
+                        matches |= std::uint64_t{1} << bit;
                     }
-                    slot_ = 0;
-                } else if (ptr_->rows[slot_].deleted) {
-                    slot_ += 1;
-                } else if (not predicate_(ptr_->rows[slot_].kv.value)) {
-                    slot_ += 1;
-                } else {
-                    break;
+                    live &= live - 1;
                 }
             }
 
-            return *this;
+            mask[w] = matches;
         }
+    }
 
-        // Postfix increment
-        iterator operator++(int) { iterator tmp = *this; ++(*this); return tmp; }
+    // fn(slot) for each live slot of the bucket, in order.
+    template<class Fn>
+    static void for_each_live_(_bucket * bucket, Fn &&fn) {
+        for (size_type w = 0; w < bitmap_words_; ++w) {
+            auto bits = bucket->live[w];
+            while (bits) {
+                fn(w * 64 + std::countr_zero(bits));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    // Roughly this many rows are handed to a worker at a time.
+    static constexpr size_type parallel_chunk_rows_ = 16 * 1024;
+    static constexpr size_type buckets_per_chunk_ =
+        rows_per_bucket_ >= parallel_chunk_rows_ ? 1 : parallel_chunk_rows_ / rows_per_bucket_;
+
+    /*
+     * Split the bucket chain into fixed size chunks and run
+     * chunk_fn(chunk_number, buckets) for each of them over `threads`
+     * threads. Chunks are claimed from a shared counter so that faster
+     * threads pick up the slack. Chunk boundaries depend only on the
+     * table, so per-chunk results can be merged deterministically.
+     *
+     * The first exception thrown by chunk_fn is rethrown once all the
+     * threads have finished.
+     */
+    template<class ChunkFn>
+    size_type run_chunks_(size_type threads, ChunkFn &&chunk_fn) const {
+        std::vector<_bucket *> buckets;
+        buckets.reserve(bucket_count_);
+        for (auto * bucket = bucket_head_; bucket; bucket = bucket->next) {
+            buckets.push_back(bucket);
+        }
 
+        size_type chunks = (buckets.size() + buckets_per_chunk_ - 1) / buckets_per_chunk_;
 
-        friend bool operator== (const iterator& a, const iterator& b) { 
-            return a.ptr_ == b.ptr_ and a.slot_ == b.slot_; 
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = std::min(threads, chunks);
+
+        std::atomic<size_type> next_chunk{0};
+        std::exception_ptr error;
+        std::atomic<bool> failed{false};
+
+        auto worker = [&]() {
+            while (not failed.load(std::memory_order_relaxed)) {
+                auto chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+                if (chunk >= chunks) break;
+
+                auto first = chunk * buckets_per_chunk_;
+                auto last = std::min(first + buckets_per_chunk_, buckets.size());
+                try {
+                    chunk_fn(chunk, std::span<_bucket * const>(buckets.data() + first, last - first));
+                } catch (...) {
+                    if (not failed.exchange(true)) {
+                        error = std::current_exception();
+                    }
+                }
+            }
         };
-        friend bool operator!= (const iterator& a, const iterator& b) { 
-            return not(a == b);
+
+        if (threads <= 1) {
+            worker();
+        } else {
+            std::vector<std::jthread> pool;
+            pool.reserve(threads - 1);
+            for (size_type i = 1; i < threads; ++i) {
+                pool.emplace_back(worker);
+            }
+            worker();
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+
+        return chunks;
+    }
+
+    void index_add_(index_handle handle, const value_type &value) {
+        for_each_declared_([&](auto &idx) { idx.add_(handle, value); });
+        for (auto &idx : index_map_) {
+            idx.second.idx->add(handle, value);
+        }
+    }
+
+    void index_remove_(index_handle handle, const value_type &value) {
+        for_each_declared_([&](auto &idx) { idx.remove_(handle, value); });
+        for (auto &idx : index_map_) {
+            idx.second.idx->remove(handle, value);
+        }
+    }
+
+    /*
+     * Run fn on the row at `ref` in place, then bring the indexes up to
+     * date. If fn throws, the indexes are still updated to whatever state
+     * it left the row in.
+     */
+    template<class Fn>
+    void update_(oid_type oid, _row_ref ref, Fn &fn) {
+        auto &row = ref.value();
+
+        if (not has_indexes_()) {
+            fn(row);
+            return;
+        }
+
+        auto handle = handle_of_(oid, ref);
+
+        // Kept here rather than in the indexes, so fn may itself update
+        // rows of this table.
+        auto old_keys = std::apply([&](auto &... idx) {
+            return std::make_tuple(idx.before_update_(row)...);
+        }, declared_.indexes);
+
+        // On the stack for the usual handful of indexes.
+        using old_state = std::pair<_index_base *, std::any>;
+        std::array<old_state, 8> inline_states;
+        std::vector<old_state> heap_states;
+        std::span<old_state> old_states = inline_states;
+        if (index_map_.size() > inline_states.size()) {
+            heap_states.resize(index_map_.size());
+            old_states = heap_states;
+        }
+
+        std::size_t n = 0;
+        for (auto &idx : index_map_) {
+            old_states[n++] = {idx.second.idx, idx.second.idx->before_update(row)};
+        }
+        old_states = old_states.first(n);
+
+        auto after = [&]() {
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                (std::get<I>(declared_.indexes).after_update_(handle, row, std::get<I>(old_keys)), ...);
+            }(std::make_index_sequence<_declared_type::size>{});
+
+            for (auto &[idx, old] : old_states) {
+                idx->after_update(handle, row, old);
+            }
         };
 
-    private :
-        _bucket * ptr_;
-        size_type slot_ = 0;
-        predicate_type predicate_;
+        try {
+            fn(row);
+        } catch (...) {
+            after();
+            throw;
+        }
+        after();
+    }
 
-    };
+    // Every live row, in oid order, for building an index.
+    std::vector<_batch_row> all_rows_() {
+        std::vector<_batch_row> rows;
+        rows.reserve(live_rows_);
+        for (auto * bucket = bucket_head_; bucket; bucket = bucket->next) {
+            for_each_live_(bucket, [&](size_type slot) {
+                rows.push_back({handle_of_(bucket->oid_at(slot), {bucket, slot}),
+                    &bucket->value_at(slot)});
+            });
+        }
 
-    struct _index_base {
+        std::sort(rows.begin(), rows.end(),
+            [](auto const &a, auto const &b) { return a.handle < b.handle; });
 
-        virtual void add(oid_type rowid, const ValueType &v) = 0;
-        virtual void remove(oid_type rowid, const ValueType &v)  = 0;
-    };
+        return rows;
+    }
 
-    struct _row_ref {
-        _bucket * ptr = nullptr;
-        size_type slot = 0;
+#pragma endregion
 
-        _row_ref(_bucket * p, size_type s) : ptr{p}, slot{s} {}
+/******************************************************
+ * Public Interface
+ ******************************************************/
+public :
+
+    iterator insert_row(const value_type &value) {
+        return emplace_row(value);
+    }
+
+    iterator insert_row(value_type &&value) {
+        return emplace_row(std::move(value));
+    }
+
+    // Construct the new row directly in the table's storage.
+    template<class... Args>
+    requires std::constructible_from<value_type, Args...>
+    iterator emplace_row(Args &&... args) {
 
-        _row &get_row() {
-            return ptr->rows[slot];
+        auto ref = place_row_(std::forward<Args>(args)...);
+        auto handle = handle_of_(ref.ptr->oid_at(ref.slot), ref);
+        index_add_(handle, ref.value());
+
+        return iterator{ref.ptr, ref.slot};
+
+    }
+
+    /*
+     * Insert many rows at once. Each index is then updated with a single
+     * batch, letting it sort the new keys and build its structure in one
+     * pass instead of doing one insertion per row.
+     *
+     * When the size of the input is known, the buckets and directory
+     * space for it are allocated before any row goes in.
+     *
+     * Values are copied, or moved if the iterators yield rvalues.
+     * Returns the number of rows inserted.
+     */
+    template<std::input_iterator It, std::sentinel_for<It> S>
+    requires std::constructible_from<value_type, std::iter_reference_t<It>>
+    size_type insert_rows(It first, S last) {
+        std::vector<_batch_row> batch;
+
+        if constexpr (std::sized_sentinel_for<S, It>) {
+            auto n = size_type(last - first);
+            row_map_.reserve(last_oid_ + n + n / rows_per_bucket_ + 1);
+            if (has_indexes_()) {
+                batch.reserve(n);
+            }
+            reserve_buckets_(n);
         }
 
-    };
+        auto index_batch = [&]() {
+            for_each_declared_([&](auto &idx) { idx.add_batch_(batch); });
+            for (auto &idx : index_map_) {
+                idx.second.idx->add_batch(batch);
+            }
+        };
 
-    struct _index_ref {
-        _index_base *idx;
-        bool is_multi;
+        size_type inserted = 0;
+        try {
+            for (; first != last; ++first) {
+                auto ref = place_row_(*first);
 
-        _index_ref(_index_base *i, bool m) : idx{i}, is_multi{m} {}
-    };
+                if (has_indexes_()) {
+                    batch.push_back({handle_of_(ref.ptr->oid_at(ref.slot), ref), &ref.value()});
+                }
+                inserted += 1;
+            }
+        } catch (...) {
+            release_spare_buckets_();
+            // keep the indexes in step with the rows that did go in.
+            index_batch();
+            throw;
+        }
+        release_spare_buckets_();
+
+        index_batch();
+
+        return inserted;
+    }
+
+    template<std::ranges::input_range R>
+    size_type insert_rows(R &&rows) {
+        if constexpr (std::is_lvalue_reference_v<R>) {
+            return insert_rows(std::ranges::begin(rows), std::ranges::end(rows));
+        } else {
+            if constexpr (std::ranges::common_range<R>) {
+                return insert_rows(std::make_move_iterator(std::ranges::begin(rows)),
+                    std::make_move_iterator(std::ranges::end(rows)));
+            } else {
+                return insert_rows(std::make_move_iterator(std::ranges::begin(rows)),
+                    std::move_sentinel(std::ranges::end(rows)));
+            }
+        }
+    }
 
-#pragma endregion
+    void delete_row(const oid_type row_num) {
 
-    /****************************************************
-     * Private Data
-     ****************************************************/
+        auto * ref = row_map_.find(row_num);
 
-    oid_type last_oid_ = 0;
+        if (ref == nullptr) {
+            return;
+        }
 
-    _bucket * bucket_head_ = nullptr;
-    _bucket * bucket_tail_ = nullptr;
+        auto &value = ref->value();
 
-    std::map<oid_type, _row_ref> row_map_;
+        index_remove_(handle_of_(row_num, *ref), value);
 
-    std::map<std::string, _index_ref> index_map_;
+        ref->ptr->destroy_at(ref->slot);
+        release_slot_(*ref);
+        row_map_.erase(row_num);
 
+    }
 
-    /****************************************************
-     * Private Methods
-     ****************************************************/
-    #pragma region
+    /*
+     * Modify a row in place by calling fn(value_type &). The row keeps
+     * its oid and its storage location. Each index compares the row's key
+     * before and after, and only an index whose key changed (or that the
+     * row moved in or out of, for a partial index) updates its storage.
+     *
+     * Returns end() if there is no such row.
+     */
+    template<class Fn>
+    requires std::invocable<Fn &, value_type &>
+    iterator update_row(const oid_type row_num, Fn &&fn) {
+
+        auto * ref = row_map_.find(row_num);
+
+        if (ref == nullptr) {
+            return end();
+        }
 
-    oid_type get_next_oid() { return ++last_oid_; }
+        update_(row_num, *ref, fn);
 
-    _bucket * add_bucket() {
-        auto oid = get_next_oid();
+        return iterator{ref->ptr, ref->slot};
+    }
 
-        auto * new_bucket = new _bucket(oid);
+    // update_row for the row an iterator is on, without the oid lookup.
+    template<class Pred, class Fn>
+    requires std::invocable<Fn &, value_type &>
+    void modify(const _scan_iterator<Pred> &iter, Fn &&fn) {
+        update_(iter->oid, {iter.ptr_, iter.slot_}, fn);
+    }
 
-        if (bucket_head_) {
-            bucket_tail_->next = new_bucket;
-            new_bucket->previous = bucket_tail_;
-            bucket_tail_ = new_bucket;
-        } else {
-            bucket_head_ = bucket_tail_ = new_bucket;
-        }
+    // Overwrite a row in place; update_row with an assignment.
+    iterator replace_row(const oid_type row_num, const value_type &value) {
+        return update_row(row_num, [&](value_type &row) { row = value; });
+    }
 
-        return new_bucket;
+    iterator replace_row(const oid_type row_num, value_type &&value) {
+        return update_row(row_num, [&](value_type &row) { row = std::move(value); });
     }
 
-    iterator find_(oid_type rowid) {
+    
 
-        auto iter = row_map_.find(rowid);
+    size_type count() const { return live_rows_; }
 
-        if (iter == row_map_.end()) {
-            return end();
-        } else {
-            return iterator(iter->second.ptr, iter->second.slot);
+    table_stats stats() const {
+        return {bucket_count_, bucket_count_ * rows_per_bucket_, used_slots_, live_rows_};
+    }
+
+    // One entry per bucket, in scan order.
+    std::vector<bucket_stats> bucket_occupancy() const {
+        std::vector<bucket_stats> retval;
+        retval.reserve(bucket_count_);
+
+        for (auto * bucket = bucket_head_; bucket; bucket = bucket->next) {
+            retval.push_back({rows_per_bucket_, bucket->used_slots, bucket->live_slots});
         }
+
+        return retval;
     }
-#pragma endregion
 
-/******************************************************
- * Public Interface
- ******************************************************/
-public :
+    /*
+     * Incrementally reclaim the space left behind by deleted rows.
+     *
+     * Each call visits at most `budget` buckets (a relocated row also
+     * counts against the budget), carrying on from where the previous
+     * call stopped. Empty buckets are unlinked and freed. If
+     * `relocate_below` is non-zero, buckets whose fraction of live rows is
+     * at or below it have their rows moved to the end of the table and
+     * are then freed. A full bucket is never relocated, and a pass only
+     * visits the buckets that existed when it started.
+     *
+     * Throws std::invalid_argument unless 0 <= relocate_below < 1.
+     *
+     * Deleted slots are reused by insert_row independently of this.
+     *
+     * Relocation moves rows, so any outstanding iterators are invalidated.
+     * Index entries record where their row is stored, so each relocated
+     * row also costs one lookup per index to update its entry.
+     */
+    compaction_stats compact(size_type budget = size_type(-1), double relocate_below = 0.0) {
+        // Also rejects NaN.
+        if (not (relocate_below >= 0.0 and relocate_below < 1.0)) {
+            throw std::invalid_argument("compact: relocate_below must be in [0, 1)");
+        }
 
-    iterator insert_row(const value_type &value) {
+        compaction_stats stats;
 
-        _bucket * bucket = bucket_tail_;
-        if (not bucket or bucket->used_slots >= rows_per_bucket_) {
-            bucket = add_bucket();
+        if (compact_cursor_ == nullptr) {
+            compact_cursor_ = bucket_head_;
+            compact_limit_ = last_oid_;
         }
 
-        auto oid = get_next_oid();
-        auto this_slot = bucket->used_slots;
-        bucket->rows[this_slot] = {oid, value};
-        bucket->used_slots += 1;
+        // Checks the count too, in case rounding takes the limit up to a
+        // whole bucket.
+        auto sparse = [&](const _bucket * bucket) {
+            return bucket->live_slots < rows_per_bucket_ and
+                bucket->live_slots <= relocate_below * rows_per_bucket_;
+        };
+
+        while (budget > 0 and compact_cursor_) {
+            auto * bucket = compact_cursor_;
+            if (bucket->oid > compact_limit_) {
+                compact_cursor_ = nullptr;
+                break;
+            }
+            budget -= 1;
 
-        row_map_.insert({oid, {bucket, this_slot}});
+            if (bucket != bucket_tail_ and not bucket->is_empty() and sparse(bucket)) {
+                // The visit already paid for the first row moved.
+                auto moved = evacuate_(bucket, budget + 1);
+                budget -= moved - 1;
+                stats.rows_moved += moved;
+            }
 
-        for(auto &idx : index_map_) {
-            idx.second.idx->add(oid, value);
+            if (bucket->is_empty()) {
+                free_bucket_(bucket);
+                stats.buckets_freed += 1;
+            } else if (sparse(bucket) and bucket != bucket_tail_) {
+                // ran out of budget part way through. Pick up here next time.
+                break;
+            } else {
+                compact_cursor_ = bucket->next;
+            }
         }
 
-        return iterator{bucket, this_slot};
+        stats.finished = (compact_cursor_ == nullptr);
 
+        return stats;
     }
 
-    void delete_row(const oid_type row_num) {
-
-        auto iter = row_map_.find(row_num);
+    /*
+     * Filter a bucket at a time. For each bucket with at least one match,
+     * `fn` is called with a row_batch describing the matching rows.
+     * The batch is only valid during the call.
+     */
+    template<class Pred, class Fn>
+    void select_batches(Pred &&pred, Fn &&fn) {
+        std::array<std::uint64_t, bitmap_words_> mask;
+        std::vector<slot_type> slots;
+        slots.reserve(rows_per_bucket_);
+
+        for (auto * bucket = bucket_head_; bucket; bucket = bucket->next) {
+            if (bucket->is_empty()) continue;
+
+            filter_bucket_(bucket, pred, mask);
+
+            slots.clear();
+            for (size_type w = 0; w < bitmap_words_; ++w) {
+                auto bits = mask[w];
+                while (bits) {
+                    slots.push_back(slot_type(w * 64 + std::countr_zero(bits)));
+                    bits &= bits - 1;
+                }
+            }
 
-        if (iter == row_map_.end()) {
-            return;
+            if (not slots.empty()) {
+                fn(row_batch(bucket, mask, slots));
+            }
         }
+    }
 
-        auto &r = iter->second.get_row();
+    template<class Pred>
+    size_type count_if(Pred &&pred) {
+        std::array<std::uint64_t, bitmap_words_> mask;
+        size_type retval = 0;
 
-        for(auto &idx : index_map_) {
-            idx.second.idx->remove(row_num, r.kv.value);
-        }
+        for (auto * bucket = bucket_head_; bucket; bucket = bucket->next) {
+            if (bucket->is_empty()) continue;
 
-        r.deleted = true;
-        row_map_.erase(row_num);
+            filter_bucket_(bucket, pred, mask);
+            for (auto word : mask) {
+                retval += std::popcount(word);
+            }
+        }
 
+        return retval;
     }
 
-    
+    /*
+     * Parallel scans.
+     *
+     * The bucket chain is split into chunks which are processed on
+     * `threads` threads (0 means one per hardware thread). The callables
+     * are called concurrently and must be safe to do so. The table must
+     * not be modified until the call returns.
+     */
+
+    // fn(row_view) for every live row, in no particular order.
+    template<class Fn>
+    void parallel_for_each(Fn &&fn, size_type threads = 0) {
+        run_chunks_(threads, [&](size_type, std::span<_bucket * const> buckets) {
+            for (auto * bucket : buckets) {
+                for_each_live_(bucket, [&](size_type slot) {
+                    fn(row_view{bucket->oid_at(slot), bucket->value_at(slot)});
+                });
+            }
+        });
+    }
 
-    size_type count() const {
-        size_type retval = 0;
-        _bucket * bucket = bucket_head_;
-        while (bucket) {
-            for (int i = 0; i < bucket->used_slots; ++i) {
-                retval += not bucket->rows[i].deleted;
+    /*
+     * Each chunk folds its rows, in table order, starting from `identity`
+     * using reduce(T, const value_type &). The chunk results are then
+     * folded, in table order, with combine(T, T). The result does not
+     * depend on the number of threads or on scheduling.
+     */
+    template<class T, class Reduce, class Combine>
+    T parallel_reduce(T identity, Reduce &&reduce, Combine &&combine, size_type threads = 0) const {
+        std::vector<T> partials((bucket_count_ + buckets_per_chunk_ - 1) / buckets_per_chunk_, identity);
+
+        run_chunks_(threads, [&](size_type chunk, std::span<_bucket * const> buckets) {
+            T acc = identity;
+            for (auto * bucket : buckets) {
+                for_each_live_(bucket, [&](size_type slot) {
+                    acc = reduce(std::move(acc), std::as_const(bucket->value_at(slot)));
+                });
             }
-            bucket = bucket->next;
+            partials[chunk] = std::move(acc);
+        });
+
+        T retval = std::move(identity);
+        for (auto &partial : partials) {
+            retval = combine(std::move(retval), std::move(partial));
         }
 
         return retval;
+    }
+
+    // oids of the rows matching `pred`, in table order.
+    template<class Pred>
+    std::vector<oid_type> parallel_select(Pred &&pred, size_type threads = 0) {
+        std::vector<std::vector<oid_type>> partials((bucket_count_ + buckets_per_chunk_ - 1) / buckets_per_chunk_);
+
+        run_chunks_(threads, [&](size_type chunk, std::span<_bucket * const> buckets) {
+            std::array<std::uint64_t, bitmap_words_> mask;
+            auto &out = partials[chunk];
+            for (auto * bucket : buckets) {
+                if (bucket->is_empty()) continue;
+
+                filter_bucket_(bucket, pred, mask);
+                for (size_type w = 0; w < bitmap_words_; ++w) {
+                    auto bits = mask[w];
+                    while (bits) {
+                        out.push_back(bucket->oid_at(w * 64 + std::countr_zero(bits)));
+                        bits &= bits - 1;
+                    }
+                }
+            }
+        });
+
+        size_type total = 0;
+        for (auto &partial : partials) total += partial.size();
+
+        std::vector<oid_type> retval;
+        retval.reserve(total);
+        for (auto &partial : partials) {
+            retval.insert(retval.end(), partial.begin(), partial.end());
+        }
 
+        return retval;
     }
 
-    auto select(predicate_type p) {
-        return iterator(
+    predicate_iterator select(predicate_type p) {
+        return predicate_iterator(
             bucket_head_,
             0,
-            p           
+            std::move(p)
         );
 
     }
 
+    template<class Pred>
+    requires std::predicate<Pred &, const value_type &> and
+        (not std::same_as<std::remove_cvref_t<Pred>, predicate_type>)
+    auto select(Pred &&p) {
+        return _scan_iterator<std::remove_cvref_t<Pred>>(
+            bucket_head_,
+            0,
+            std::forward<Pred>(p)
+        );
+    }
+
     auto begin() {
         return iterator(
             bucket_head_,
@@ -324,140 +2279,559 @@ public :
         }
     }
 
-    template<typename IndexType>
-    struct table_index : public _index_base {
-        using accessor_type = std::function<IndexType(const ValueType &)>;
+    /*
+     * Walks index entries in storage order - key order for the tree
+     * backends - and yields the rows they refer to.
+     */
+    template<class StorageType>
+    struct _index_iterator {
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+
+        using value_type = Table::value_type;
 
-        table_index(accessor_type accessor, Table *t) : table_{t}, accessor_{accessor} {}
+        using pointer = value_type*;
+        using reference = value_type&;
 
-        size_type count() const { return index_data_map_.size(); }
+        using key_type = typename StorageType::key_type;
+        using handle_type = typename StorageType::handle_type;
+        using storage_iterator = typename StorageType::const_iterator;
 
-        iterator find(IndexType const &idx) {
+        struct arrow_proxy {
+            row_view view;
+            const row_view *operator->() const { return &view; }
+        };
 
-            auto iter = index_data_map_.find(idx);
-            if (iter == index_data_map_.end()) {
-                return table_->end();
-            } else {
-                return table_->find_(iter->second);
-            }
+        explicit _index_iterator(storage_iterator iter) : iter_{iter} {}
+
+        row_view operator*() const {
+            auto const &handle = StorageType::handle_of(iter_);
+            return {handle.oid, static_cast<_bucket *>(handle.bucket)->value_at(handle.slot)};
         }
 
-        private :
-            accessor_type accessor_;
-            Table * table_;
+        arrow_proxy operator->() const { return {operator*()}; }
 
-            std::map<IndexType, oid_type> index_data_map_;
+        // The index key of the current row.
+        const key_type &key() const { return StorageType::key_of(iter_); }
 
-            void add(oid_type rowid, const ValueType &v) {
-                index_data_map_.insert({accessor_(v), rowid});
-            }
+        oid_type oid() const { return StorageType::handle_of(iter_).oid; }
+
+        // The fields a covering index keeps for the current row. Reading
+        // them does not touch the row itself.
+        const auto &covered() const requires requires (const handle_type &h) { h.covered; } {
+            return StorageType::handle_of(iter_).covered;
+        }
+
+        _index_iterator & operator++() { ++iter_; return *this; }
+        _index_iterator operator++(int) { _index_iterator tmp = *this; ++(*this); return tmp; }
+
+        friend bool operator== (const _index_iterator& a, const _index_iterator& b) {
+            return a.iter_ == b.iter_;
+        };
 
-            virtual void remove(oid_type rowid, const ValueType &v) {
-                index_data_map_.erase(accessor_(v));
-            }            
+    private :
+        storage_iterator iter_;
+    };
 
+    template<class StorageType>
+    struct _index_range {
+        _index_iterator<StorageType> first;
+        _index_iterator<StorageType> last;
+
+        auto begin() const { return first; }
+        auto end() const { return last; }
+        bool empty() const { return first == last; }
     };
 
+    /*
+     * The lookups and maintenance shared by every kind of index. Accessor
+     * computes the key of a row. Projector, unless it is _no_projection,
+     * computes the fields a covering index stores in each entry; the
+     * storage's handle_type is then a covering_handle.
+     */
+    template<class Accessor, typename IndexType, class StorageType, class Projector = _no_projection>
+    struct _index_core {
+        using key_type = IndexType;
+        using storage_type = StorageType;
+        using key_iterator = _index_iterator<storage_type>;
+        using key_range = _index_range<storage_type>;
 
-    template<typename IT>
-    table_index<IT> & create_index(std::string name, table_index<IT>::accessor_type a) {
-        auto * idx = new table_index<IT>(a, this);
-        index_map_.insert({name, {idx, false}});
-        
-        for (auto & iter : *this) {
-            dynamic_cast<_index_base *>(idx)->add(iter.oid, iter.value);
-        }
+        static constexpr bool is_covering = not std::is_same_v<Projector, _no_projection>;
 
-        return *idx;
-    }
+        _index_core(Accessor accessor, Table *t) : table_{t}, accessor_{std::move(accessor)} {}
 
-    template<typename IndexType>
-    struct table_multi_index : public _index_base {
-        using accessor_type = std::function<IndexType(const ValueType &)>;
+        _index_core(Accessor accessor, Projector projector, Table *t) requires is_covering
+            : table_{t}, accessor_{std::move(accessor)}, projector_{std::move(projector)} {}
+
+        explicit _index_core(Table *t) requires std::default_initializable<Accessor> : table_{t} {}
 
-        table_multi_index(accessor_type accessor, Table *t) : table_{t}, accessor_{accessor} {}
+        size_type count() const { return index_data_.size(); }
 
-        size_type count() const { return index_data_map_.size(); }
+        // The stored fields of the (first) row with the key, or nullptr.
+        // Answered from the index alone.
+        const auto *covered(IndexType const &key) const requires is_covering {
+            auto * handle = index_data_.find(key);
+            return handle == nullptr ? nullptr : &handle->covered;
+        }
 
+        // The (first) row with the key, as a table iterator.
         iterator find(IndexType const &idx) {
 
-            auto iter = index_data_map_.find(idx);
-            if (iter == index_data_map_.end()) {
+            auto * handle = index_data_.find(idx);
+            if (handle == nullptr) {
                 return table_->end();
             } else {
-                return table_->find_(iter->second);
+                return iterator(static_cast<_bucket *>(handle->bucket), handle->slot);
             }
         }
 
+        // Every row with the key.
+        key_range equal_range(IndexType const &key) {
+            auto [first, last] = index_data_.equal_range(key);
+            return {key_iterator{first}, key_iterator{last}};
+        }
+
+        // Every row, in key order.
+        key_iterator begin() { return key_iterator{index_data_.begin()}; }
+        key_iterator end() { return key_iterator{index_data_.end()}; }
+
+        key_iterator lower_bound(IndexType const &key) requires ordered_index_storage<storage_type> {
+            return key_iterator{index_data_.lower_bound(key)};
+        }
+
+        key_iterator upper_bound(IndexType const &key) requires ordered_index_storage<storage_type> {
+            return key_iterator{index_data_.upper_bound(key)};
+        }
+
+        // Rows with lo <= key < hi, in key order.
+        key_range range(IndexType const &lo, IndexType const &hi) requires ordered_index_storage<storage_type> {
+            auto first = lower_bound(lo);
+            if (not (lo < hi)) return {first, first};
+
+            return {first, lower_bound(hi)};
+        }
+
         private :
-            accessor_type accessor_;
+            friend class Table;
+
+            using handle_type = typename storage_type::handle_type;
+
             Table * table_;
+            [[no_unique_address]] Accessor accessor_;
+            [[no_unique_address]] Projector projector_;
+
+            storage_type index_data_;
 
-            std::multimap<IndexType, oid_type> index_data_map_;
+            handle_type make_handle_(index_handle row, const ValueType &v) {
+                if constexpr (is_covering) {
+                    return {row, projector_(v)};
+                } else {
+                    return row;
+                }
+            }
 
-            void add(oid_type rowid, const ValueType &v) {
-                index_data_map_.insert({accessor_(v), rowid});
+            void add_(index_handle row, const ValueType &v) {
+                index_data_.insert(accessor_(v), make_handle_(row, v));
             }
 
-            virtual void remove(oid_type rowid, const ValueType &v) {
+            /*
+             * Compute the entries for a batch of rows. For ordered storage
+             * they are sorted by key, with ties left in oid order.
+             */
+            void add_batch_(std::span<const _batch_row> rows) {
+                std::vector<std::pair<IndexType, handle_type>> entries;
+                entries.reserve(rows.size());
+                for (auto const &r : rows) {
+                    entries.emplace_back(accessor_(*r.value), make_handle_(r.handle, *r.value));
+                }
+
+                if constexpr (ordered_index_storage<storage_type>) {
+                    std::stable_sort(entries.begin(), entries.end(),
+                        [](auto const &a, auto const &b) { return a.first < b.first; });
+                }
 
-                // multiple rows may map to the same key.
-                // So we need to find the one that has the same rowid.
+                index_data_.insert_sorted(entries);
+            }
 
-                auto [start, end] = index_data_map_.equal_range(accessor_(v));
+            void remove_(index_handle row, const ValueType &v) {
+                index_data_.erase(accessor_(v), row);
+            }
 
-                while(start != end) {
-                    if (start->second == rowid) {
-                        index_data_map_.erase(start);
-                        break;
+            void relink_(index_handle row, const ValueType &v) {
+                if (auto * entry = index_data_.find(accessor_(v), row)) {
+                    entry->bucket = row.bucket;
+                    entry->slot = row.slot;
+                }
+            }
+
+            // The key of a row about to be updated, for after_update_.
+            IndexType before_update_(const ValueType &v) const {
+                return accessor_(v);
+            }
+
+            void after_update_(index_handle row, const ValueType &v, const IndexType &old_key) {
+                decltype(auto) key = accessor_(v);
+
+                if (not (key == old_key)) {
+                    index_data_.erase(old_key, row);
+                    index_data_.insert(key, make_handle_(row, v));
+                } else if constexpr (is_covering) {
+                    if (auto * entry = index_data_.find(key, row)) {
+                        entry->covered = projector_(v);
                     }
-                    ++start;
                 }
-            }            
+            }
+
+            // after_update_ for a row that no longer belongs in the index.
+            void drop_updated_(index_handle row, const IndexType &old_key) {
+                index_data_.erase(old_key, row);
+            }
 
     };
 
+    // The key type produced by calling Key on a row.
+    template<auto Key>
+    using _invoke_key_t = std::remove_cvref_t<std::invoke_result_t<decltype(Key), const ValueType &>>;
+
+    /*
+     * An index created at run time. Accessor is a std::function for
+     * table_index / table_multi_index, or a _row_key that calls a member
+     * pointer (or other invocable) directly for table_index_on /
+     * table_multi_index_on.
+     *
+     * If the index has a filter, only the rows it accepts are indexed.
+     */
+    template<class Accessor, typename IndexType, class StorageType, class Projector = _no_projection>
+    struct _keyed_index : public _index_base, public _index_core<Accessor, IndexType, StorageType, Projector> {
+        using core_type = _index_core<Accessor, IndexType, StorageType, Projector>;
+        using core_type::core_type;
+
+        bool is_partial() const { return static_cast<bool>(filter_); }
 
-    template<typename IT>
-    table_multi_index<IT> & create_multi_index(std::string name, table_index<IT>::accessor_type a) {
-        auto * idx = new table_multi_index<IT>(a, this);
-        index_map_.insert({name, {idx, true}});
+        private :
+            friend class Table;
 
-        for (auto & iter : *this) {
-            dynamic_cast<_index_base *>(idx)->add(iter.oid, iter.value);
-        }
+            predicate_type filter_;
+
+            bool admits_(const ValueType &v) const { return not filter_ or filter_(v); }
+
+            void add(index_handle row, const ValueType &v) override {
+                if (admits_(v)) this->add_(row, v);
+            }
+
+            void add_batch(std::span<const _batch_row> rows) override {
+                if (not filter_) {
+                    this->add_batch_(rows);
+                    return;
+                }
+
+                std::vector<_batch_row> kept;
+                for (auto const &r : rows) {
+                    if (filter_(*r.value)) kept.push_back(r);
+                }
+                this->add_batch_(kept);
+            }
+
+            void remove(index_handle row, const ValueType &v) override {
+                if (admits_(v)) this->remove_(row, v);
+            }
+
+            void relink(index_handle row, const ValueType &v) override {
+                if (admits_(v)) this->relink_(row, v);
+            }
+
+            // The old key, or nothing if the row was not in the index.
+            std::any before_update(const ValueType &v) override {
+                if (not admits_(v)) return {};
+                return this->before_update_(v);
+            }
+
+            void after_update(index_handle row, const ValueType &v, std::any &old) override {
+                auto *old_key = std::any_cast<IndexType>(&old);
+                bool admitted = admits_(v);
+                if (old_key and admitted) {
+                    this->after_update_(row, v, *old_key);
+                } else if (old_key) {
+                    this->drop_updated_(row, *old_key);
+                } else if (admitted) {
+                    this->add_(row, v);
+                }
+            }
+    };
+
+    template<typename IndexType, class Storage = default_index_storage>
+    struct table_index : public _keyed_index<std::function<IndexType(const ValueType &)>,
+            IndexType, typename Storage::template unique<IndexType>> {
+        using accessor_type = std::function<IndexType(const ValueType &)>;
+        using base_type = _keyed_index<accessor_type, IndexType, typename Storage::template unique<IndexType>>;
+
+        table_index(accessor_type accessor, Table *t) : base_type(std::move(accessor), t) {}
+    };
+
+    template<typename IndexType, class Storage = default_index_storage>
+    struct table_multi_index : public _keyed_index<std::function<IndexType(const ValueType &)>,
+            IndexType, typename Storage::template multi<IndexType>> {
+        using accessor_type = std::function<IndexType(const ValueType &)>;
+        using base_type = _keyed_index<accessor_type, IndexType, typename Storage::template multi<IndexType>>;
+
+        table_multi_index(accessor_type accessor, Table *t) : base_type(std::move(accessor), t) {}
+    };
+
+    /*
+     * Indexes whose key is computed by calling Key - a pointer to a data
+     * member, a pointer to a const member function, or a captureless
+     * lambda - on the row. The call is direct rather than through a
+     * std::function, and a key returned by reference is used in place,
+     * so only the copy stored in the index is ever made.
+     */
+    template<auto Key, class Storage = default_index_storage>
+    struct table_index_on : public _keyed_index<_row_key<Key>,
+            _invoke_key_t<Key>, typename Storage::template unique<_invoke_key_t<Key>>> {
+        using base_type = _keyed_index<_row_key<Key>,
+            _invoke_key_t<Key>, typename Storage::template unique<_invoke_key_t<Key>>>;
+
+        explicit table_index_on(Table *t) : base_type(t) {}
+    };
+
+    template<auto Key, class Storage = default_index_storage>
+    struct table_multi_index_on : public _keyed_index<_row_key<Key>,
+            _invoke_key_t<Key>, typename Storage::template multi<_invoke_key_t<Key>>> {
+        using base_type = _keyed_index<_row_key<Key>,
+            _invoke_key_t<Key>, typename Storage::template multi<_invoke_key_t<Key>>>;
+
+        explicit table_multi_index_on(Table *t) : base_type(t) {}
+    };
+
+    /*
+     * Covering indexes keep a Projection of each row - typically a small
+     * struct or tuple of the fields a hot query needs - in the index
+     * entry next to the key. covered(key), and covered() on the
+     * iterators, read it without going to the row.
+     *
+     * The copy is made when the row is indexed.
+     */
+    template<typename IndexType, typename Projection, class Storage = default_index_storage>
+    struct table_covering_index : public _keyed_index<std::function<IndexType(const ValueType &)>,
+            IndexType, typename Storage::template unique<IndexType, covering_handle<Projection>>,
+            std::function<Projection(const ValueType &)>> {
+        using accessor_type = std::function<IndexType(const ValueType &)>;
+        using projector_type = std::function<Projection(const ValueType &)>;
+        using base_type = _keyed_index<accessor_type, IndexType,
+            typename Storage::template unique<IndexType, covering_handle<Projection>>, projector_type>;
+
+        table_covering_index(accessor_type accessor, projector_type projector, Table *t)
+            : base_type(std::move(accessor), std::move(projector), t) {}
+    };
+
+    template<typename IndexType, typename Projection, class Storage = default_index_storage>
+    struct table_covering_multi_index : public _keyed_index<std::function<IndexType(const ValueType &)>,
+            IndexType, typename Storage::template multi<IndexType, covering_handle<Projection>>,
+            std::function<Projection(const ValueType &)>> {
+        using accessor_type = std::function<IndexType(const ValueType &)>;
+        using projector_type = std::function<Projection(const ValueType &)>;
+        using base_type = _keyed_index<accessor_type, IndexType,
+            typename Storage::template multi<IndexType, covering_handle<Projection>>, projector_type>;
+
+        table_covering_multi_index(accessor_type accessor, projector_type projector, Table *t)
+            : base_type(std::move(accessor), std::move(projector), t) {}
+    };
+
+private :
+
+    template<class IndexT>
+    IndexT & add_index_(std::string name, IndexT * idx, bool is_multi, predicate_type filter) {
+        idx->filter_ = std::move(filter);
+        index_map_.insert({name, {idx, is_multi}});
+
+        static_cast<_index_base *>(idx)->add_batch(all_rows_());
 
         return *idx;
     }
 
-    template<typename IT>
-    table_index<IT> &index(std::string name) {
+    template<class IndexT>
+    IndexT & named_index_(const std::string &name, bool is_multi) {
         auto iter = index_map_.find(name);
         if (iter == index_map_.end()) {
             throw std::runtime_error("No index named '" + name + "'");
         }
 
-        if (iter->second.is_multi) {
-            throw std::runtime_error("Index named '" + name + "' is a multi index");
+        if (iter->second.is_multi != is_multi) {
+            throw std::runtime_error("Index named '" + name + (is_multi ? "' is not" : "' is") + " a multi index");
+        }
+
+        auto * idx = dynamic_cast<IndexT *>(iter->second.idx);
+        if (idx == nullptr) {
+            throw std::runtime_error("Index named '" + name + "' has a different key or storage type");
         }
 
-        return *(dynamic_cast<table_index<IT> *>(iter->second.idx));
+        return *idx;
+    }
+
+public :
+
+    /*
+     * Every create_*index function takes an optional filter as its last
+     * argument. If one is given the index is partial: only rows the
+     * filter accepts are indexed. Inserts and deletes of other rows do
+     * not touch the index at all.
+     */
+    template<typename IT, class Storage = default_index_storage>
+    table_index<IT, Storage> & create_index(std::string name, typename table_index<IT, Storage>::accessor_type a,
+            predicate_type filter = {}) {
+        return add_index_(std::move(name), new table_index<IT, Storage>(std::move(a), this), false, std::move(filter));
     }
 
-    template<typename IT>
-    table_multi_index<IT> &multi_index(std::string name) {
-        auto iter = index_map_.find(name);
-        if (iter == index_map_.end()) {
-            throw std::runtime_error("No index named '" + name + "'");
-        }
+    template<auto Key, class Storage = default_index_storage>
+    table_index_on<Key, Storage> & create_index(std::string name, predicate_type filter = {}) {
+        return add_index_(std::move(name), new table_index_on<Key, Storage>(this), false, std::move(filter));
+    }
+
+    /*
+     * An index that only answers equality lookups, kept in a flat hash
+     * table. Hash defaults to std::hash<IT>.
+     *
+     * Retrieve it with index<IT, hash_storage<Hash>>(name).
+     */
+    template<typename IT, class Hash = void>
+    table_index<IT, hash_storage<Hash>> & create_hash_index(std::string name,
+            typename table_index<IT, hash_storage<Hash>>::accessor_type a, predicate_type filter = {}) {
+        return create_index<IT, hash_storage<Hash>>(std::move(name), std::move(a), std::move(filter));
+    }
+
+    template<typename IT, class Storage = default_index_storage>
+    table_multi_index<IT, Storage> & create_multi_index(std::string name, typename table_index<IT, Storage>::accessor_type a,
+            predicate_type filter = {}) {
+        return add_index_(std::move(name), new table_multi_index<IT, Storage>(std::move(a), this), true, std::move(filter));
+    }
+
+    template<auto Key, class Storage = default_index_storage>
+    table_multi_index_on<Key, Storage> & create_multi_index(std::string name, predicate_type filter = {}) {
+        return add_index_(std::move(name), new table_multi_index_on<Key, Storage>(this), true, std::move(filter));
+    }
+
+    template<typename IT, typename Projection, class Storage = default_index_storage>
+    table_covering_index<IT, Projection, Storage> & create_covering_index(std::string name,
+            typename table_covering_index<IT, Projection, Storage>::accessor_type a,
+            typename table_covering_index<IT, Projection, Storage>::projector_type p,
+            predicate_type filter = {}) {
+        return add_index_(std::move(name),
+            new table_covering_index<IT, Projection, Storage>(std::move(a), std::move(p), this), false,
+            std::move(filter));
+    }
+
+    template<typename IT, typename Projection, class Storage = default_index_storage>
+    table_covering_multi_index<IT, Projection, Storage> & create_covering_multi_index(std::string name,
+            typename table_covering_multi_index<IT, Projection, Storage>::accessor_type a,
+            typename table_covering_multi_index<IT, Projection, Storage>::projector_type p,
+            predicate_type filter = {}) {
+        return add_index_(std::move(name),
+            new table_covering_multi_index<IT, Projection, Storage>(std::move(a), std::move(p), this), true,
+            std::move(filter));
+    }
+
+    template<typename IT, class Storage = default_index_storage>
+    table_index<IT, Storage> &index(std::string name) {
+        return named_index_<table_index<IT, Storage>>(name, false);
+    }
+
+    template<auto Key, class Storage = default_index_storage>
+    table_index_on<Key, Storage> &index(std::string name) {
+        return named_index_<table_index_on<Key, Storage>>(name, false);
+    }
+
+    template<typename IT, class Storage = default_index_storage>
+    table_multi_index<IT, Storage> &multi_index(std::string name) {
+        return named_index_<table_multi_index<IT, Storage>>(name, true);
+    }
+
+    template<auto Key, class Storage = default_index_storage>
+    table_multi_index_on<Key, Storage> &multi_index(std::string name) {
+        return named_index_<table_multi_index_on<Key, Storage>>(name, true);
+    }
+
+    template<typename IT, typename Projection, class Storage = default_index_storage>
+    table_covering_index<IT, Projection, Storage> &covering_index(std::string name) {
+        return named_index_<table_covering_index<IT, Projection, Storage>>(name, false);
+    }
+
+    template<typename IT, typename Projection, class Storage = default_index_storage>
+    table_covering_multi_index<IT, Projection, Storage> &covering_multi_index(std::string name) {
+        return named_index_<table_covering_multi_index<IT, Projection, Storage>>(name, true);
+    }
+
+    /*
+     * A declared index (see index_on), by its key. There is no lookup at
+     * run time - this compiles down to a member access.
+     */
+    template<auto Key>
+    auto &index() {
+        constexpr auto pos = _declared_type::template position<Key>;
+        static_assert(pos < _declared_type::size, "No index is declared on this key");
+
+        return std::get<pos>(declared_.indexes);
+    }
+
+private :
+    /****************************************************
+     * Declared Indexes
+     ****************************************************/
+    #pragma region
+
+    template<class Decl>
+    using _declared_key_t = _invoke_key_t<Decl::key>;
 
-        if (not iter->second.is_multi) {
-            throw std::runtime_error("Index named '" + name + "' is not a multi index");
+    template<class Decl>
+    using _declared_storage_t = std::conditional_t<Decl::is_multi,
+        typename Decl::storage_policy::template multi<_declared_key_t<Decl>>,
+        typename Decl::storage_policy::template unique<_declared_key_t<Decl>>>;
+
+    template<class Decl>
+    using _declared_index = _index_core<_row_key<Decl::key>, _declared_key_t<Decl>, _declared_storage_t<Decl>>;
+
+    template<class... Decls>
+    struct _declared_indexes {
+        static constexpr std::size_t size = sizeof...(Decls);
+
+        template<auto Key>
+        static constexpr std::size_t position = _index_position<Key, Decls...>();
+
+        template<std::size_t... I>
+        static constexpr bool distinct_(std::index_sequence<I...>) {
+            return ((_index_position<Decls::key, Decls...>() == I) and ...);
         }
+        static_assert(distinct_(std::index_sequence_for<Decls...>{}),
+            "Only one index can be declared on a key");
+
+        std::tuple<_declared_index<Decls>...> indexes;
+
+        template<class> static Table *table_for_(Table *t) { return t; }
+
+        explicit _declared_indexes([[maybe_unused]] Table *t) : indexes(table_for_<Decls>(t)...) {}
+    };
 
-        return *(dynamic_cast<table_multi_index<IT> *>(iter->second.idx));
+    template<class Tuple>
+    struct _declared_from;
+
+    template<class... Decls>
+    struct _declared_from<std::tuple<Decls...>> {
+        using type = _declared_indexes<Decls...>;
+    };
+
+    using _declared_type = typename _declared_from<decltype(std::tuple_cat(
+        std::declval<std::conditional_t<_index_option<Options>, std::tuple<Options>, std::tuple<>>>()...))>::type;
+
+    _declared_type declared_{this};
+
+    template<class Fn>
+    void for_each_declared_(Fn &&fn) {
+        std::apply([&](auto &... idx) { (fn(idx), ...); }, declared_.indexes);
+    }
+
+    bool has_indexes_() const {
+        return _declared_type::size > 0 or not index_map_.empty();
     }
 
+#pragma endregion
 
 // ------------- END of CLASS Table -------------
 };
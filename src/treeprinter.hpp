@@ -8,11 +8,11 @@
 
 namespace BPT {
 
-template<class K, class V, std::size_t FO>
+template<class K, class V, std::size_t FO, std::size_t LC = default_leaf_capacity<K, V, FO>>
 class tree_printer {
 
-    using tree_type = BPT::BPlusTree<K, V, FO>;
-    using node_ptr_type = BPT::BPlusTree<K, V, FO>::tree_node_type *;
+    using tree_type = BPT::BPlusTree<K, V, FO, LC>;
+    using node_ptr_type = typename tree_type::node_type *;
 
     const tree_type & tree_;
     std::queue<std::pair<int, node_ptr_type>> queue_;
@@ -43,20 +43,22 @@ public:
             } else {
                 std::cout << ' ';
             }
-            print_node(current_level+1, curr_pair.second);
+            print_node(current_level, curr_pair.second);
         }
 
         std::cout << "\n";
 
         if (print_values) {
             std::cout << "VALUES -- \n";
-            auto * value_ptr = tree_.get_values();
+            auto * leaf_ptr = tree_.get_first_leaf();
 
-            while (value_ptr != nullptr) {
-                std::cout << "(" << get_alias(value_ptr) << ") " << 
-                    (value_ptr->deleted ? 'D' : ' ') << value_ptr->kv.key << ", " << 
-                    value_ptr->kv.value << "\n";
-                value_ptr = value_ptr->next;
+            while (leaf_ptr != nullptr) {
+                for (std::size_t i = 0; i < leaf_ptr->num_keys; ++i) {
+                    std::cout << "(" << get_alias(leaf_ptr) << ") " <<
+                        (leaf_ptr->deleted[i] ? 'D' : ' ') << leaf_ptr->keys[i] << ", " <<
+                        leaf_ptr->values[i] << "\n";
+                }
+                leaf_ptr = leaf_ptr->next;
             }
         }
 /* 
@@ -82,40 +84,37 @@ public:
 
     }
 
-    void print_node(int child_level, node_ptr_type node_ptr) {
+    void print_node(int level, node_ptr_type node_ptr) {
         int alias = get_alias(node_ptr);
 
-        if (node_ptr) {
-            int parent = get_alias(node_ptr->parent);
+        if (not node_ptr) {
+            std::cout << "<0>[ ?? ]";
+            return;
+        }
 
-            std::cout << "<" << alias << ">[" <<parent << ":" << node_ptr->num_keys << ":" << (node_ptr->is_internal() ? 'I' : 'L');
+        int parent = get_alias(node_ptr->parent);
+        bool internal = std::size_t(level) < tree_.height();
 
-            for (int i = 0; i < node_ptr->num_keys; ++i) {
-                if (node_ptr->is_internal()) {
-                    std::cout << " (" << get_alias(node_ptr->child_ptrs[i]) << ")"  << ' ' << node_ptr->keys[i];
-                } else {
-                    std::cout << ' ' << node_ptr->keys[i] <<
-                        (node_ptr->deleted[i] ? "D" : "") <<
-                        "/" << get_alias(node_ptr->child_ptrs[i]);
-                }
-            }
+        std::cout << "<" << alias << ">[" <<parent << ":" << node_ptr->num_keys << ":" << (internal ? 'I' : 'L');
 
-            if (node_ptr->is_internal()) {
-                std::cout << " (" << get_alias(node_ptr->child_ptrs[node_ptr->num_keys]) << ")";
+        if (internal) {
+            auto *node = static_cast<typename tree_type::internal_node_type *>(node_ptr);
 
+            for (std::size_t i = 0; i < node->num_keys; ++i) {
+                std::cout << " (" << get_alias(node->child_ptrs[i]) << ")"  << ' ' << node->keys[i];
             }
+            std::cout << " (" << get_alias(node->child_ptrs[node->num_keys]) << ") ]";
 
-            std::cout << " ]";
-
-            if (node_ptr->is_internal()) {
-                for (int i = 0; i < node_ptr->num_keys+1; ++i) {
-                    queue_.push(std::make_pair(child_level, 
-                        (node_ptr_type)node_ptr->child_ptrs[i]));
-                }                
+            for (std::size_t i = 0; i < node->num_keys+1; ++i) {
+                queue_.push(std::make_pair(level + 1, node->child_ptrs[i]));
             }
         } else {
-            std::cout << "<0>[ ?? ]";
+            auto *leaf = static_cast<typename tree_type::leaf_node_type *>(node_ptr);
 
+            for (std::size_t i = 0; i < leaf->num_keys; ++i) {
+                std::cout << ' ' << leaf->keys[i] << (leaf->deleted[i] ? "D" : "");
+            }
+            std::cout << " ]";
         }
 
     }
@@ -2,6 +2,8 @@
 
 #include <catch2/catch_all.hpp>
 
+#include <string>
+
 using namespace Memorandum;
 
 
@@ -62,3 +64,168 @@ TEST_CASE("predicate", "[basic]") {
     REQUIRE(iter == int_table.end());
 
 }
+
+TEST_CASE("type-erased predicate", "[basic]") {
+    Table<int> int_table;
+    int_table.insert_row(43);
+    int_table.insert_row(99);
+    int_table.insert_row(77);
+
+    int limit = 99;
+    Table<int>::predicate_type pred = [&](const int &a) { return a < limit; };
+
+    Table<int>::predicate_iterator iter = int_table.select(pred);
+    REQUIRE(iter->value == 43);
+    ++iter;
+    REQUIRE(iter->value == 77);
+    ++iter;
+    REQUIRE(iter == int_table.end());
+
+    // iterators holding a capturing lambda can be reassigned.
+    auto big = [&](const int &a) { return a > limit - 30; };
+    auto lambda_iter = int_table.select(big);
+    REQUIRE(lambda_iter->value == 99);
+    lambda_iter = int_table.select(big);
+    ++lambda_iter;
+    REQUIRE(lambda_iter->value == 77);
+    ++lambda_iter;
+    REQUIRE(lambda_iter == int_table.end());
+}
+
+TEST_CASE("layouts", "[basic]") {
+    static_assert(rows_to_fill<int>(4096) == 1024);
+    static_assert(rows_to_fill<std::array<char, 1000>>(4096) == 64);
+    static_assert(default_layout<double>::rows_per_bucket % 64 == 0);
+
+    Table<int, bucket_layout<10, row_layout::interleaved>> interleaved;
+    Table<int, bucket_layout<10, row_layout::split>> split;
+
+    for (int i = 0; i < 35; ++i) {
+        interleaved.insert_row(i);
+        split.insert_row(i);
+    }
+
+    REQUIRE(interleaved.stats().buckets == 4);
+    REQUIRE(split.stats().buckets == 4);
+
+    interleaved.delete_row(interleaved.begin()->oid);
+    split.delete_row(split.begin()->oid);
+
+    auto a = interleaved.begin();
+    auto b = split.begin();
+    while (a != interleaved.end()) {
+        REQUIRE(b != split.end());
+        REQUIRE(a->value == b->value);
+        ++a; ++b;
+    }
+    REQUIRE(b == split.end());
+    REQUIRE(interleaved.count() == 34);
+}
+
+TEST_CASE("batch select", "[basic]") {
+    Table<int, bucket_layout<128>> int_table;
+
+    for (int i = 0; i < 1000; ++i) {
+        int_table.insert_row(i);
+    }
+    for (auto iter = int_table.select([](const int &a) { return a % 7 == 0; });
+            iter != int_table.end(); ++iter) {
+        int_table.delete_row(iter->oid);
+    }
+
+    auto even = [](const int &a) { return a % 2 == 0; };
+
+    std::vector<int> seen;
+    std::size_t batches = 0;
+    int_table.select_batches(even, [&](const auto &batch) {
+        batches += 1;
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            seen.push_back(batch[i].value);
+        }
+        std::size_t bits = 0;
+        for (auto word : batch.mask()) bits += std::popcount(word);
+        REQUIRE(bits == batch.size());
+    });
+
+    std::vector<int> expected;
+    for (auto iter = int_table.select(even); iter != int_table.end(); ++iter) {
+        expected.push_back(iter->value);
+    }
+
+    REQUIRE(batches == 8);
+    REQUIRE(seen == expected);
+    REQUIRE(int_table.count_if(even) == expected.size());
+}
+
+namespace {
+
+// No default constructor, and counts how many are alive.
+struct tracked {
+    static inline int alive = 0;
+
+    std::string name;
+    int n;
+
+    tracked(std::string s, int i) : name{std::move(s)}, n{i} { alive += 1; }
+    tracked(const tracked &o) : name{o.name}, n{o.n} { alive += 1; }
+    tracked(tracked &&o) : name{std::move(o.name)}, n{o.n} { alive += 1; }
+    tracked &operator=(const tracked &) = default;
+    ~tracked() { alive -= 1; }
+
+    bool operator==(const tracked &o) const { return name == o.name and n == o.n; }
+};
+
+}
+
+TEST_CASE("emplace and raw storage", "[basic]") {
+    {
+        Table<tracked, bucket_layout<64>> table;
+
+        // nothing is constructed until a row is inserted.
+        auto iter = table.emplace_row("first", 1);
+        REQUIRE(tracked::alive == 1);
+        REQUIRE(iter->value.name == "first");
+
+        tracked t{"second", 2};
+        table.insert_row(std::move(t));
+        table.insert_row(t);
+        REQUIRE(tracked::alive == 4);
+
+        table.delete_row(iter->oid);
+        REQUIRE(tracked::alive == 3);
+
+        for (int i = 0; i < 200; ++i) {
+            table.emplace_row("row", i);
+        }
+        REQUIRE(tracked::alive == 203);
+
+        for (auto iter = table.select([](const tracked &v) { return v.n < 150; });
+                iter != table.end(); ++iter) {
+            table.delete_row(iter->oid);
+        }
+        table.compact(std::size_t(-1), 0.9);
+        REQUIRE(tracked::alive == int(table.count()) + 1);
+    }
+
+    REQUIRE(tracked::alive == 0);
+}
+
+TEST_CASE("update in place", "[basic]") {
+    Table<int> int_table;
+    auto first = int_table.insert_row(43)->oid;
+    int_table.insert_row(99);
+
+    auto iter = int_table.update_row(first, [](int &v) { v += 1; });
+    REQUIRE(iter->oid == first);
+    REQUIRE(iter->value == 44);
+    REQUIRE(int_table.begin()->value == 44);
+
+    for (auto i = int_table.begin(); i != int_table.end(); ++i) {
+        int_table.modify(i, [](int &v) { v *= 2; });
+    }
+    REQUIRE(int_table.begin()->value == 88);
+    REQUIRE(int_table.replace_row(first, 7)->value == 7);
+
+    REQUIRE(int_table.update_row(12345, [](int &v) { v = 0; }) == int_table.end());
+    REQUIRE(int_table.count() == 2);
+}
@@ -0,0 +1,199 @@
+#include <memorandum.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <cmath>
+#include <iterator>
+#include <vector>
+
+using namespace Memorandum;
+
+// Fix the bucket size so the bucket counts below are predictable.
+template<class T>
+using SmallTable = Table<T, bucket_layout<100>>;
+
+struct row {
+    int key; int data;
+    bool operator==(const row &a) const = default;
+};
+
+TEST_CASE("slot reuse", "[compaction]") {
+    Table<int> int_table;
+
+    auto first = int_table.insert_row(1);
+    int_table.insert_row(2);
+
+    auto oid = first->oid;
+    int_table.delete_row(oid);
+
+    // the freed slot is handed to the next insert.
+    auto reused = int_table.insert_row(3);
+    REQUIRE(reused == int_table.begin());
+    REQUIRE(reused->oid != oid);
+    REQUIRE(int_table.count() == 2);
+}
+
+TEST_CASE("occupancy stats", "[compaction]") {
+    SmallTable<int> int_table;
+
+    REQUIRE(int_table.stats().buckets == 0);
+
+    for (int i = 0; i < 150; ++i) {
+        int_table.insert_row(i);
+    }
+    int_table.delete_row(int_table.begin()->oid);
+
+    auto stats = int_table.stats();
+    REQUIRE(stats.buckets == 2);
+    REQUIRE(stats.used_slots == 150);
+    REQUIRE(stats.live_rows == 149);
+    REQUIRE(stats.capacity >= stats.used_slots);
+
+    auto buckets = int_table.bucket_occupancy();
+    REQUIRE(buckets.size() == 2);
+    REQUIRE(buckets[0].live_rows + buckets[1].live_rows == 149);
+    REQUIRE(buckets[0].used_slots + buckets[1].used_slots == 150);
+    REQUIRE(buckets[0].live_rows == buckets[0].used_slots - 1);
+}
+
+TEST_CASE("empty buckets are freed", "[compaction]") {
+    SmallTable<row> table;
+    auto &idx = table.create_index<int>("key", [](const row &r) { return r.key; });
+    auto &by_tens = table.create_multi_index<int>("tens", [](const row &r) { return r.data / 10; });
+    auto &by_hash = table.create_hash_index<int>("hash", [](const row &r) { return r.key; });
+    auto &by_cover = table.create_covering_index<int, int, hash_storage<>>("cover",
+        [](const row &r) { return r.key; }, [](const row &r) { return r.data; });
+
+    for (int i = 0; i < 1000; ++i) {
+        table.insert_row({i, i});
+    }
+    for (int i = 0; i < 500; ++i) {
+        table.delete_row(idx.find(i)->oid);
+    }
+
+    auto stats = table.compact();
+    REQUIRE(stats.finished);
+    REQUIRE(stats.buckets_freed == 5);
+    REQUIRE(stats.rows_moved == 0);
+
+    REQUIRE(table.count() == 500);
+    REQUIRE(table.stats().buckets == 5);
+    REQUIRE(table.stats().used_slots == 500);
+    REQUIRE(idx.find(750)->value == row{750, 750});
+    REQUIRE(table.begin()->value == row{500, 500});
+
+    // Every index still reaches the surviving rows.
+    REQUIRE(by_hash.find(750)->value == row{750, 750});
+    REQUIRE(by_hash.find(250) == table.end());
+    REQUIRE(by_tens.count() == 500);
+    auto tens = by_tens.equal_range(75);
+    REQUIRE(std::distance(tens.begin(), tens.end()) == 10);
+    REQUIRE(tens.begin()->value.data / 10 == 75);
+    REQUIRE(by_cover.find(750)->value == row{750, 750});
+    REQUIRE(*by_cover.covered(750) == 750);
+    REQUIRE(by_cover.covered(250) == nullptr);
+}
+
+TEST_CASE("relocation with a budget", "[compaction]") {
+    SmallTable<row> table;
+    auto &idx = table.create_index<int>("key", [](const row &r) { return r.key; });
+    auto &by_tens = table.create_multi_index<int>("tens", [](const row &r) { return r.data / 10; });
+    auto &by_hash = table.create_hash_index<int>("hash", [](const row &r) { return r.key; });
+    auto &by_cover = table.create_covering_index<int, int, hash_storage<>>("cover",
+        [](const row &r) { return r.key; }, [](const row &r) { return r.data; });
+
+    for (int i = 0; i < 1000; ++i) {
+        table.insert_row({i, i});
+    }
+    // leave every tenth row alive.
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 10 != 0) table.delete_row(idx.find(i)->oid);
+    }
+
+    SmallTable<row>::compaction_stats total;
+    int calls = 0;
+    while (true) {
+        auto stats = table.compact(8, 0.5);
+        total.buckets_freed += stats.buckets_freed;
+        total.rows_moved += stats.rows_moved;
+        calls += 1;
+        if (stats.finished) break;
+    }
+
+    REQUIRE(calls > 1);
+    REQUIRE(total.rows_moved > 0);
+    REQUIRE(total.buckets_freed >= 9);
+    REQUIRE(table.count() == 100);
+    REQUIRE(table.stats().buckets <= 2);
+
+    // Index entries point straight at the rows, so relocation has to
+    // update them.
+    for (int i = 0; i < 1000; i += 10) {
+        auto iter = idx.find(i);
+        REQUIRE(iter != table.end());
+        REQUIRE(iter->value == row{i, i});
+        REQUIRE(by_hash.find(i)->oid == iter->oid);
+        REQUIRE(by_cover.find(i)->oid == iter->oid);
+        REQUIRE(*by_cover.covered(i) == i);
+    }
+
+    int tens = 0;
+    for (auto r : by_tens) {
+        REQUIRE(r.value.data == r.value.key);
+        REQUIRE(r.value.key == tens * 10);
+        tens += 1;
+    }
+    REQUIRE(tens == 100);
+
+    int seen = 0;
+    for (auto iter = table.begin(); iter != table.end(); ++iter) {
+        seen += 1;
+    }
+    REQUIRE(seen == 100);
+}
+
+TEST_CASE("relocation moves a row at most once per pass", "[compaction]") {
+    SmallTable<row> table;
+    auto &idx = table.create_index<int>("key", [](const row &r) { return r.key; });
+
+    for (int i = 0; i < 1000; ++i) {
+        table.insert_row({i, i});
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        table.delete_row(idx.find(i)->oid);
+    }
+
+    // Every bucket would count as sparse.
+    REQUIRE_THROWS(table.compact(8, 1.0));
+    REQUIRE_THROWS(table.compact(8, -0.5));
+    REQUIRE_THROWS(table.compact(8, std::nan("")));
+
+    auto stats = table.compact(200, 0.99);
+    REQUIRE_FALSE(stats.finished);
+    auto moved = stats.rows_moved;
+
+    // Leave a hole in every bucket, including the ones rows were just
+    // moved into. Those are for the next pass.
+    int n = 0;
+    std::vector<SmallTable<row>::oid_type> doomed;
+    for (auto iter = table.begin(); iter != table.end(); ++iter) {
+        if (n++ % 50 == 0) doomed.push_back(iter->oid);
+    }
+    for (auto oid : doomed) {
+        table.delete_row(oid);
+    }
+
+    int calls = 1;
+    while (not stats.finished) {
+        stats = table.compact(200, 0.99);
+        moved += stats.rows_moved;
+        calls += 1;
+        REQUIRE(calls < 100);
+    }
+    REQUIRE(moved <= 500);
+    REQUIRE(table.count() == 500 - doomed.size());
+
+    for (auto iter = table.begin(); iter != table.end(); ++iter) {
+        REQUIRE(idx.find(iter->value.key)->oid == iter->oid);
+    }
+}
@@ -0,0 +1,80 @@
+#include <memorandum.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <string>
+
+using namespace Memorandum;
+
+TEST_CASE("parallel for_each", "[parallel]") {
+    Table<long, bucket_layout<64>> table;
+
+    long expected = 0;
+    for (long i = 0; i < 200'000; ++i) {
+        table.insert_row(i);
+        expected += i;
+    }
+
+    std::atomic<long> sum{0};
+    std::atomic<std::size_t> rows{0};
+    table.parallel_for_each([&](auto row) {
+        sum += row.value;
+        rows += 1;
+    }, 4);
+
+    REQUIRE(rows == table.count());
+    REQUIRE(sum == expected);
+}
+
+TEST_CASE("parallel reduce is deterministic", "[parallel]") {
+    Table<int, bucket_layout<64>> table;
+    for (int i = 0; i < 100'000; ++i) {
+        table.insert_row(i % 10);
+    }
+
+    auto concat = [](std::string acc, const int &v) {
+        if (acc.size() < 8) acc += char('0' + v);
+        return acc;
+    };
+    auto combine = [](std::string a, std::string b) { return a.size() < 8 ? a + b : a; };
+
+    auto one = table.parallel_reduce(std::string{}, concat, combine, 1);
+    auto many = table.parallel_reduce(std::string{}, concat, combine, 8);
+
+    REQUIRE(one == "01234567");
+    REQUIRE(one == many);
+
+    auto total = table.parallel_reduce(0L,
+        [](long acc, const int &v) { return acc + v; },
+        [](long a, long b) { return a + b; });
+    REQUIRE(total == 450'000);
+}
+
+TEST_CASE("parallel select", "[parallel]") {
+    Table<int, bucket_layout<64>> table;
+    for (int i = 0; i < 50'000; ++i) {
+        table.insert_row(i);
+    }
+
+    auto pred = [](const int &v) { return v % 3 == 0; };
+    auto oids = table.parallel_select(pred, 4);
+
+    std::vector<Table<int>::oid_type> expected;
+    for (auto iter = table.select(pred); iter != table.end(); ++iter) {
+        expected.push_back(iter->oid);
+    }
+
+    REQUIRE(oids == expected);
+}
+
+TEST_CASE("parallel exceptions", "[parallel]") {
+    Table<int, bucket_layout<64>> table;
+    for (int i = 0; i < 50'000; ++i) {
+        table.insert_row(i);
+    }
+
+    REQUIRE_THROWS(table.parallel_for_each([](auto row) {
+        if (row.value == 40'000) throw std::runtime_error("boom");
+    }, 4));
+}
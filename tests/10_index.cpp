@@ -2,6 +2,14 @@
 
 #include <catch2/catch_all.hpp>
 
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
 using namespace Memorandum;
 
 struct test { 
@@ -72,4 +80,640 @@ TEST_CASE("multi-index", "[index]") {
     REQUIRE(r3->value == test{1, 4});
  
 
-}
\ No newline at end of file
+}
+TEST_CASE("index lookup across many rows", "[index]") {
+    Table<test> test_table{};
+
+    auto &idx = test_table.create_index<int>("idx", [&](const test &o) { return o.a; });
+
+    for (int i = 0; i < 5000; ++i) {
+        test_table.insert_row({i, i * 2});
+    }
+
+    REQUIRE(test_table.count() == 5000);
+
+    // Delete a contiguous run so that whole directory pages empty out.
+    for (int i = 0; i < 3000; ++i) {
+        test_table.delete_row(idx.find(i)->oid);
+    }
+
+    REQUIRE(test_table.count() == 2000);
+    REQUIRE(idx.find(10) == test_table.end());
+    REQUIRE(idx.find(4321)->value == test{4321, 8642});
+
+    test_table.insert_row({9999, 1});
+    REQUIRE(idx.find(9999)->value == test{9999, 1});
+}
+
+TEST_CASE("bulk insert", "[index]") {
+    Table<test> test_table{};
+
+    auto &idx = test_table.create_index<int>("idx", [&](const test &o) { return o.a; });
+    auto &multi = test_table.create_multi_index<int>("multi", [&](const test &o) { return o.b; });
+
+    test_table.insert_row({-1, 0});
+
+    std::vector<test> rows;
+    for (int i = 999; i >= 0; --i) {
+        rows.push_back({i, i % 10});
+    }
+    // duplicate key - like insert_row, the first one in wins.
+    rows.push_back({5, 99});
+
+    REQUIRE(test_table.insert_rows(rows) == 1001);
+
+    REQUIRE(test_table.count() == 1002);
+    REQUIRE(idx.count() == 1001);
+    REQUIRE(multi.count() == 1002);
+
+    REQUIRE(idx.find(5)->value == test{5, 5});
+    REQUIRE(idx.find(-1)->value == test{-1, 0});
+    REQUIRE(idx.find(999)->value == test{999, 9});
+    REQUIRE(multi.find(99)->value == test{5, 99});
+
+    // rows added later still land in the right place.
+    test_table.insert_row({1000, 1});
+    REQUIRE(idx.find(1000)->value == test{1000, 1});
+}
+
+TEST_CASE("bulk insert moves from rvalue ranges", "[index]") {
+    Table<std::string> table{};
+
+    auto &idx = table.create_index<std::string>("idx", [](const std::string &s) { return s; });
+
+    std::vector<std::string> rows{"one", "two", "three"};
+    table.insert_rows(std::move(rows));
+
+    REQUIRE(table.count() == 3);
+    REQUIRE(idx.find("two") != table.end());
+}
+
+TEST_CASE("bulk insert fills free slots before new buckets", "[index]") {
+    Table<int, bucket_layout<100>> table{};
+
+    std::vector<int> rows(250, 7);
+    REQUIRE(table.insert_rows(rows) == 250);
+    REQUIRE(table.stats().buckets == 3);
+
+    for (int i = 0; i < 50; ++i) {
+        table.delete_row(table.begin()->oid);
+    }
+
+    // 50 deleted slots and 50 never used ones take all of these.
+    rows.resize(100);
+    table.insert_rows(rows);
+    REQUIRE(table.count() == 300);
+    REQUIRE(table.stats().buckets == 3);
+
+    rows.resize(101);
+    table.insert_rows(rows);
+    REQUIRE(table.count() == 401);
+    REQUIRE(table.stats().buckets == 5);
+}
+
+TEST_CASE("index storage backends", "[index]") {
+    Table<test> test_table{};
+
+    auto &by_map = test_table.create_index<int, map_storage>("map", [](const test &o) { return o.a; });
+    auto &by_tree = test_table.create_index<int, bptree_storage<8>>("tree", [](const test &o) { return o.a; });
+    auto &multi_map = test_table.create_multi_index<int, map_storage>("mmap", [](const test &o) { return o.b; });
+    auto &multi_tree = test_table.create_multi_index<int, bptree_storage<8>>("mtree", [](const test &o) { return o.b; });
+
+    for (int i = 0; i < 500; ++i) {
+        test_table.insert_row({i, i % 7});
+    }
+    for (int i = 0; i < 500; i += 3) {
+        test_table.delete_row(by_map.find(i)->oid);
+    }
+
+    REQUIRE(by_map.count() == by_tree.count());
+    REQUIRE(multi_map.count() == multi_tree.count());
+    REQUIRE(multi_tree.count() == test_table.count());
+
+    for (int i = 0; i < 500; ++i) {
+        REQUIRE(by_map.find(i) == by_tree.find(i));
+    }
+    for (int b = 0; b < 7; ++b) {
+        REQUIRE(multi_map.find(b) != test_table.end());
+        REQUIRE(multi_tree.find(b)->value.b == b);
+    }
+
+    REQUIRE(&test_table.index<int, map_storage>("map") == &by_map);
+    REQUIRE_THROWS(test_table.index<int>("map"));
+}
+
+TEST_CASE("deleting a duplicate keeps the indexed row", "[index]") {
+    Table<test> test_table{};
+
+    auto &idx = test_table.create_index<int>("idx", [](const test &o) { return o.a; });
+
+    test_table.insert_row({1, 1});
+    auto dup = test_table.insert_row({1, 2});
+
+    // only the first row is in the index - deleting the second
+    // must not take the first out.
+    test_table.delete_row(dup->oid);
+
+    REQUIRE(idx.count() == 1);
+    REQUIRE(idx.find(1)->value == test{1, 1});
+}
+
+TEST_CASE("hash index", "[index]") {
+    Table<test> test_table{};
+
+    auto &idx = test_table.create_hash_index<int>("by_a", [](const test &o) { return o.a; });
+
+    std::vector<Table<test>::oid_type> oids;
+    for (int i = 0; i < 1000; ++i) {
+        oids.push_back(test_table.insert_row({i, i * 2})->oid);
+    }
+
+    REQUIRE(idx.count() == 1000);
+    REQUIRE(idx.find(500)->value == test{500, 1000});
+    REQUIRE(idx.find(1000) == test_table.end());
+
+    // Deleting out of the middle of probe runs must not lose the rest.
+    for (int i = 0; i < 1000; i += 3) {
+        test_table.delete_row(oids[i]);
+    }
+
+    REQUIRE(idx.count() == 666);
+    for (int i = 0; i < 1000; ++i) {
+        auto iter = idx.find(i);
+        if (i % 3 == 0) {
+            REQUIRE(iter == test_table.end());
+        } else {
+            REQUIRE(iter != test_table.end());
+            REQUIRE(iter->value.b == i * 2);
+        }
+    }
+
+    REQUIRE(&test_table.index<int, hash_storage<>>("by_a") == &idx);
+    REQUIRE_THROWS(test_table.index<int>("by_a"));
+}
+
+TEST_CASE("hash index with a custom hasher", "[index]") {
+    // Every key collides - lookups must still compare keys.
+    struct constant_hash {
+        std::size_t operator()(const std::string &) const { return 7; }
+    };
+
+    struct named {
+        std::string name; int n;
+        bool operator==(const named &) const = default;
+    };
+
+    Table<named> test_table{};
+    test_table.insert_row({"zero", 0});
+
+    auto &idx = test_table.create_hash_index<std::string, constant_hash>("by_name",
+        [](const named &o) { return o.name; });
+
+    auto one = test_table.insert_row({"one", 1})->oid;
+    test_table.insert_row({"two", 2});
+
+    REQUIRE(idx.find("zero")->value.n == 0);
+    REQUIRE(idx.find("two")->value.n == 2);
+
+    test_table.delete_row(one);
+
+    REQUIRE(idx.find("one") == test_table.end());
+    REQUIRE(idx.find("two")->value.n == 2);
+    REQUIRE(idx.count() == 2);
+}
+
+// Equality only - a hash index must not need operator<.
+struct colour {
+    int rgb;
+    bool operator==(const colour &) const = default;
+};
+
+struct colour_hash {
+    std::size_t operator()(const colour &c) const { return std::hash<int>{}(c.rgb); }
+};
+
+TEST_CASE("hash index keys need only equality", "[index]") {
+    Table<test> test_table{};
+
+    auto &by_a = test_table.create_hash_index<colour, colour_hash>("by_a",
+        [](const test &o) { return colour{o.a}; });
+    auto &by_b = test_table.create_multi_index<colour, hash_storage<colour_hash>>("by_b",
+        [](const test &o) { return colour{o.b}; });
+
+    std::vector<test> rows;
+    for (int i = 0; i < 100; ++i) {
+        rows.push_back({i, i % 3});
+    }
+    test_table.insert_rows(rows);
+
+    REQUIRE(by_a.count() == 100);
+    REQUIRE(by_b.count() == 100);
+    auto ones = by_b.equal_range(colour{1});
+    REQUIRE(std::distance(ones.begin(), ones.end()) == 33);
+
+    // The key stays, then changes.
+    auto oid = by_a.find(colour{42})->oid;
+    test_table.update_row(oid, [](test &t) { t.b = 1; });
+    REQUIRE(by_a.find(colour{42})->value.b == 1);
+
+    test_table.update_row(oid, [](test &t) { t.a = 420; });
+    REQUIRE(by_a.find(colour{42}) == test_table.end());
+    REQUIRE(by_a.find(colour{420})->oid == oid);
+    REQUIRE(by_a.count() == 100);
+}
+
+TEST_CASE("hash storage matches std::multimap", "[index]") {
+    hash_table_storage<int, std::hash<int>, true> storage;
+    std::multimap<int, std::size_t> expected;
+
+    std::uint32_t seed = 1;
+    auto next = [&] { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+
+    for (std::size_t oid = 0; oid < 20000; ++oid) {
+        int key = next() % 512;
+        if (next() % 3 == 0 and not expected.empty()) {
+            auto iter = expected.lower_bound(key);
+            if (iter == expected.end()) iter = expected.begin();
+            REQUIRE(storage.erase(iter->first, {iter->second}));
+            expected.erase(iter);
+        } else {
+            REQUIRE(storage.insert(key, {oid}));
+            expected.emplace(key, oid);
+        }
+    }
+
+    REQUIRE(storage.size() == expected.size());
+    REQUIRE(std::size_t(std::distance(storage.begin(), storage.end())) == expected.size());
+    for (auto const &[key, oid] : expected) {
+        REQUIRE(storage.find(key) != nullptr);
+    }
+    for (auto iter = storage.begin(); iter != storage.end(); ++iter) {
+        auto [first, last] = expected.equal_range(decltype(storage)::key_of(iter));
+        REQUIRE(std::any_of(first, last,
+            [&](auto const &e) { return e.second == decltype(storage)::handle_of(iter).oid; }));
+    }
+}
+
+TEST_CASE("hash storage with heavy keys", "[index]") {
+    // A few keys, so most postings outgrow the small sorted vector.
+    hash_table_storage<int, std::hash<int>, true> storage;
+    std::map<int, std::set<std::size_t>> expected;
+
+    std::mt19937 rng(11);
+    std::vector<std::size_t> oids(6000);
+    std::iota(oids.begin(), oids.end(), 1);
+    std::shuffle(oids.begin(), oids.end(), rng);
+
+    for (auto oid : oids) {
+        int key = int(oid % 5);
+        REQUIRE(storage.insert(key, {oid}));
+        REQUIRE_FALSE(storage.insert(key, {oid}));
+        expected[key].insert(oid);
+    }
+
+    std::shuffle(oids.begin(), oids.end(), rng);
+    for (std::size_t n = 0; n < oids.size(); n += 2) {
+        int key = int(oids[n] % 5);
+        REQUIRE(storage.erase(key, {oids[n]}));
+        REQUIRE_FALSE(storage.erase(key, {oids[n]}));
+        expected[key].erase(oids[n]);
+    }
+    // Empty one key completely.
+    for (auto oid : std::set<std::size_t>(expected[3])) {
+        REQUIRE(storage.erase(3, {oid}));
+    }
+    expected.erase(3);
+
+    std::size_t left = 0;
+    for (auto const &[key, rows] : expected) {
+        left += rows.size();
+    }
+    REQUIRE(storage.size() == left);
+    REQUIRE(std::size_t(std::distance(storage.begin(), storage.end())) == storage.size());
+    REQUIRE(storage.find(3) == nullptr);
+
+    for (auto const &[key, rows] : expected) {
+        std::vector<std::size_t> found;
+        auto [first, last] = storage.equal_range(key);
+        for (; first != last; ++first) {
+            found.push_back(first->oid);
+        }
+        REQUIRE(found == std::vector<std::size_t>(rows.begin(), rows.end()));
+        REQUIRE(storage.find(key)->oid == *rows.begin());
+        REQUIRE(storage.find(key, {*rows.rbegin()})->oid == *rows.rbegin());
+    }
+}
+
+TEMPLATE_TEST_CASE("range scans", "[index]", map_storage, bptree_storage<4>) {
+    Table<test> test_table{};
+
+    auto &idx = test_table.create_index<int, TestType>("a", [](const test &o) { return o.a; });
+
+    // Keys 0, 10, 20, ... 990, inserted out of order.
+    for (int i = 0; i < 100; ++i) {
+        test_table.insert_row({(i * 37) % 100 * 10, i});
+    }
+
+    std::vector<int> keys;
+    for (auto row : idx.range(205, 300)) {
+        keys.push_back(row.value.a);
+    }
+    REQUIRE(keys == std::vector<int>{210, 220, 230, 240, 250, 260, 270, 280, 290});
+
+    REQUIRE(idx.lower_bound(210).key() == 210);
+    REQUIRE(idx.upper_bound(210).key() == 220);
+    REQUIRE(idx.lower_bound(991) == idx.end());
+    REQUIRE(idx.range(300, 300).empty());
+    REQUIRE(idx.range(400, 300).empty());
+
+    auto hit = idx.equal_range(500);
+    REQUIRE(std::distance(hit.begin(), hit.end()) == 1);
+    REQUIRE(hit.begin()->value.a == 500);
+    REQUIRE(idx.equal_range(505).empty());
+
+    int previous = -1;
+    std::size_t seen = 0;
+    for (auto iter = idx.begin(); iter != idx.end(); ++iter) {
+        REQUIRE(iter.key() > previous);
+        previous = iter.key();
+        seen += 1;
+    }
+    REQUIRE(seen == 100);
+}
+
+TEMPLATE_TEST_CASE("multi index duplicates", "[index]", map_storage, bptree_storage<4>, hash_storage<>) {
+    Table<test> test_table{};
+
+    auto &idx = test_table.create_multi_index<int, TestType>("a", [](const test &o) { return o.a; });
+
+    std::vector<Table<test>::oid_type> oids;
+    for (int i = 0; i < 60; ++i) {
+        oids.push_back(test_table.insert_row({i % 3, i})->oid);
+    }
+
+    test_table.delete_row(oids[4]);
+
+    std::vector<int> bs;
+    for (auto row : idx.equal_range(1)) {
+        REQUIRE(row.value.a == 1);
+        bs.push_back(row.value.b);
+    }
+    std::sort(bs.begin(), bs.end());
+
+    std::vector<int> expected;
+    for (int i = 1; i < 60; i += 3) {
+        if (i != 4) expected.push_back(i);
+    }
+    REQUIRE(bs == expected);
+
+    REQUIRE(idx.equal_range(3).empty());
+}
+
+TEMPLATE_TEST_CASE("deleting the rows of a heavy key", "[index]", map_storage, bptree_storage<8>, hash_storage<>) {
+    Table<test> test_table{};
+
+    auto &idx = test_table.create_multi_index<int, TestType>("a", [](const test &o) { return o.a; });
+
+    std::vector<Table<test>::oid_type> heavy;
+    for (int i = 0; i < 3000; ++i) {
+        auto oid = test_table.insert_row({i % 10 == 0 ? i : 7, i})->oid;
+        if (i % 10 != 0) heavy.push_back(oid);
+    }
+
+    // Delete from the middle outwards so removal is not always at one end.
+    std::vector<Table<test>::oid_type> order;
+    for (std::size_t lo = heavy.size() / 2, hi = lo + 1; order.size() < heavy.size(); ) {
+        order.push_back(heavy[lo]);
+        if (hi < heavy.size()) order.push_back(heavy[hi++]);
+        if (lo == 0) break;
+        --lo;
+    }
+    REQUIRE(order.size() == heavy.size());
+
+    for (std::size_t n = 0; n < order.size(); ++n) {
+        test_table.delete_row(order[n]);
+        if (n == order.size() / 2) {
+            auto rows = idx.equal_range(7);
+            REQUIRE(std::size_t(std::distance(rows.begin(), rows.end())) == order.size() - n - 1);
+        }
+    }
+
+    REQUIRE(idx.count() == 300);
+    REQUIRE(idx.equal_range(7).empty());
+    REQUIRE(idx.find(7) == test_table.end());
+    REQUIRE(idx.find(2990)->value.b == 2990);
+}
+
+struct person {
+    std::string name;
+    int age;
+
+    bool operator==(const person &) const = default;
+
+    const std::string &get_name() const { return name; }
+};
+
+TEST_CASE("member pointer keys", "[index]") {
+    Table<person> table;
+    table.insert_row({"ann", 30});
+
+    auto &by_name = table.create_index<&person::name>("name");
+    auto &by_age = table.create_multi_index<&person::age>("age");
+    auto &by_getter = table.create_index<&person::get_name, hash_storage<>>("getter");
+
+    auto bob = table.insert_row({"bob", 30})->oid;
+    table.insert_row({"cy", 41});
+
+    REQUIRE(by_name.count() == 3);
+    REQUIRE(by_name.find("bob")->value.age == 30);
+    REQUIRE(by_getter.find("cy")->value.age == 41);
+
+    auto thirty = by_age.equal_range(30);
+    REQUIRE(std::distance(thirty.begin(), thirty.end()) == 2);
+
+    table.delete_row(bob);
+    REQUIRE(by_name.find("bob") == table.end());
+    REQUIRE(by_getter.find("bob") == table.end());
+    REQUIRE(by_age.count() == 2);
+
+    REQUIRE(&table.index<&person::name>("name") == &by_name);
+    REQUIRE(&table.multi_index<&person::age>("age") == &by_age);
+    REQUIRE_THROWS(table.index<&person::get_name>("name"));
+    REQUIRE_THROWS(table.index<std::string>("name"));
+}
+
+TEMPLATE_TEST_CASE("covering indexes", "[index]", map_storage, bptree_storage<4>, hash_storage<>) {
+    using summary = std::pair<std::string, int>;
+
+    Table<person> table;
+    table.insert_row({"ann", 30});
+
+    auto &by_name = table.template create_covering_index<std::string, int, TestType>("name",
+        [](const person &p) { return p.name; },
+        [](const person &p) { return p.age; });
+    auto &by_age = table.template create_covering_multi_index<int, summary, TestType>("age",
+        [](const person &p) { return p.age; },
+        [](const person &p) { return summary{p.name, p.age * 2}; });
+
+    std::vector<person> more;
+    for (int i = 0; i < 200; ++i) {
+        more.push_back({"p" + std::to_string(i), i % 10});
+    }
+    table.insert_rows(more);
+    auto bob = table.insert_row({"bob", 30})->oid;
+
+    REQUIRE(by_name.count() == 202);
+    REQUIRE(*by_name.covered("ann") == 30);
+    REQUIRE(*by_name.covered("p17") == 7);
+    REQUIRE(by_name.covered("zed") == nullptr);
+    REQUIRE(by_name.find("bob")->value.age == 30);
+
+    auto thirty = by_age.equal_range(30);
+    std::vector<std::string> names;
+    for (auto iter = thirty.begin(); iter != thirty.end(); ++iter) {
+        REQUIRE(iter.covered().second == 60);
+        REQUIRE(iter->value.name == iter.covered().first);
+        names.push_back(iter.covered().first);
+    }
+    REQUIRE(names == std::vector<std::string>{"ann", "bob"});
+
+    table.delete_row(bob);
+    REQUIRE(by_name.covered("bob") == nullptr);
+    REQUIRE(by_age.equal_range(30).begin().oid() == table.begin()->oid);
+
+    auto seven = by_age.equal_range(7);
+    std::size_t sevens = 0;
+    for (auto iter = seven.begin(); iter != seven.end(); ++iter) {
+        REQUIRE(iter.key() == 7);
+        REQUIRE(iter.covered().second == 14);
+        ++sevens;
+    }
+    REQUIRE(sevens == 20);
+
+    REQUIRE(&table.template covering_index<std::string, int, TestType>("name") == &by_name);
+    REQUIRE(&table.template covering_multi_index<int, summary, TestType>("age") == &by_age);
+    REQUIRE_THROWS(table.template index<std::string, TestType>("name"));
+}
+
+TEST_CASE("partial indexes", "[index]") {
+    Table<test> table;
+    table.insert_row({1, 0});
+    table.insert_row({2, 1});
+
+    auto odd_b = [](const test &t) { return t.b % 2 == 1; };
+
+    auto &by_a = table.create_index<int>("a", [](const test &t) { return t.a; }, odd_b);
+    auto &by_b = table.create_multi_index<int, hash_storage<>>("b", [](const test &t) { return t.b; }, odd_b);
+    auto &all_a = table.create_index<&test::a>("all a");
+
+    REQUIRE(by_a.is_partial());
+    REQUIRE_FALSE(all_a.is_partial());
+    REQUIRE(by_a.count() == 1);
+    REQUIRE(by_a.find(1) == table.end());
+    REQUIRE(by_a.find(2)->value.b == 1);
+
+    std::vector<test> more;
+    for (int i = 10; i < 110; ++i) {
+        more.push_back({i, i});
+    }
+    table.insert_rows(more);
+    auto three = table.insert_row({3, 3})->oid;
+    auto four = table.insert_row({4, 4})->oid;
+
+    REQUIRE(by_a.count() == 52);
+    REQUIRE(by_b.count() == 52);
+    REQUIRE(all_a.count() == 104);
+    REQUIRE(by_a.find(11) != table.end());
+    REQUIRE(by_a.find(12) == table.end());
+
+    // deleting a row the filter rejected leaves the index alone.
+    table.delete_row(four);
+    table.delete_row(three);
+    REQUIRE(by_a.count() == 51);
+    REQUIRE(by_a.find(3) == table.end());
+
+    SECTION("rows move in and out on replace") {
+        auto one = all_a.find(1)->oid;
+        auto twelve = all_a.find(12)->oid;
+        auto thirteen = all_a.find(13)->oid;
+
+        REQUIRE(table.replace_row(one, {1, 5})->oid == one);
+        REQUIRE(by_a.find(1)->oid == one);
+        REQUIRE(by_b.find(5)->oid == one);
+
+        table.replace_row(thirteen, {13, 14});
+        REQUIRE(by_a.find(13) == table.end());
+        REQUIRE(by_b.equal_range(13).empty());
+
+        table.replace_row(twelve, {120, 13});
+        REQUIRE(by_a.find(12) == table.end());
+        REQUIRE(by_a.find(120)->oid == twelve);
+        REQUIRE(all_a.find(120)->oid == twelve);
+        REQUIRE(by_b.find(13)->oid == twelve);
+
+        REQUIRE(by_a.count() == 52);
+        REQUIRE(table.count() == 102);
+        REQUIRE(table.replace_row(9999, {0, 0}) == table.end());
+    }
+}
+
+TEMPLATE_TEST_CASE("updating rows", "[index]", map_storage, bptree_storage<4>, hash_storage<>) {
+    Table<test> table;
+
+    auto &by_a = table.template create_index<&test::a, TestType>("a");
+    auto &by_b = table.template create_multi_index<&test::b, TestType>("b");
+    auto &b_of_a = table.template create_covering_index<int, int, TestType>("b of a",
+        [](const test &t) { return t.a; }, [](const test &t) { return t.b; });
+    auto &big_b = table.template create_index<int, TestType>("big b",
+        [](const test &t) { return t.b; }, [](const test &t) { return t.b >= 100; });
+
+    std::vector<typename Table<test>::oid_type> oids;
+    for (int i = 0; i < 100; ++i) {
+        oids.push_back(table.insert_row({i, i % 10})->oid);
+    }
+
+    // b changes, a does not.
+    auto iter = table.update_row(oids[5], [](test &t) { t.b = 7; });
+    REQUIRE(iter->oid == oids[5]);
+    REQUIRE(by_a.find(5)->oid == oids[5]);
+    REQUIRE(*b_of_a.covered(5) == 7);
+    REQUIRE(by_b.count() == 100);
+    REQUIRE(std::distance(by_b.equal_range(7).begin(), by_b.equal_range(7).end()) == 11);
+    REQUIRE(std::distance(by_b.equal_range(5).begin(), by_b.equal_range(5).end()) == 9);
+
+    // a changes, and the row enters the partial index.
+    table.update_row(oids[6], [](test &t) { t.a = 600; t.b = 150; });
+    REQUIRE(by_a.find(6) == table.end());
+    REQUIRE(by_a.find(600)->oid == oids[6]);
+    REQUIRE(b_of_a.covered(6) == nullptr);
+    REQUIRE(*b_of_a.covered(600) == 150);
+    REQUIRE(big_b.find(150)->oid == oids[6]);
+
+    // ... and leaves it again.
+    for (auto i = table.begin(); i != table.end(); ++i) {
+        if (i->oid == oids[6]) {
+            table.modify(i, [](test &t) { t.b = 6; });
+        }
+    }
+    REQUIRE(big_b.count() == 0);
+    REQUIRE(by_b.find(6) != table.end());
+
+    // a unique key that is already taken leaves the row out, as insert does.
+    table.update_row(oids[7], [](test &t) { t.a = 8; });
+    REQUIRE(by_a.find(8)->oid == oids[8]);
+    REQUIRE(by_a.find(7) == table.end());
+    REQUIRE(by_a.count() == 99);
+
+    // if the update throws, the indexes follow what it left behind.
+    REQUIRE_THROWS(table.update_row(oids[9], [](test &t) {
+        t.a = 900;
+        throw std::runtime_error("half done");
+    }));
+    REQUIRE(by_a.find(900)->oid == oids[9]);
+    REQUIRE(by_a.find(9) == table.end());
+
+    table.delete_row(oids[9]);
+    REQUIRE(by_a.find(900) == table.end());
+    REQUIRE(by_b.count() == 99);
+    REQUIRE(b_of_a.count() == 98);
+}
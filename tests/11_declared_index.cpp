@@ -0,0 +1,131 @@
+#include <memorandum.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace Memorandum;
+
+struct note {
+    int id;
+    int track;
+    std::string name;
+
+    bool operator==(const note &) const = default;
+
+    std::size_t name_length() const { return name.size(); }
+};
+
+using note_table = Table<note,
+    index_on<&note::id>,
+    multi_index_on<&note::track>,
+    index_on<&note::name, hash_storage<>>>;
+
+TEST_CASE("declared indexes", "[declared_index]") {
+    note_table table;
+
+    auto a = table.insert_row({1, 10, "a"})->oid;
+    table.insert_row({2, 10, "b"});
+    table.insert_row({3, 20, "c"});
+
+    auto &by_id = table.index<&note::id>();
+    auto &by_track = table.index<&note::track>();
+    auto &by_name = table.index<&note::name>();
+
+    REQUIRE(by_id.count() == 3);
+    REQUIRE(by_id.find(2)->value.name == "b");
+    REQUIRE(by_name.find("c")->value.id == 3);
+
+    auto tens = by_track.equal_range(10);
+    REQUIRE(std::distance(tens.begin(), tens.end()) == 2);
+
+    table.delete_row(a);
+
+    REQUIRE(by_id.find(1) == table.end());
+    REQUIRE(by_name.find("a") == table.end());
+    REQUIRE(by_track.count() == 2);
+
+    // Same object every time.
+    REQUIRE(&table.index<&note::id>() == &by_id);
+}
+
+TEST_CASE("declared indexes with a layout and dynamic indexes", "[declared_index]") {
+    Table<note, bucket_layout<64>, index_on<&note::name_length>> table;
+
+    static_assert(decltype(table)::layout_type::rows_per_bucket == 64);
+
+    auto &by_id = table.create_index<int>("id", [](const note &n) { return n.id; });
+
+    std::vector<note> rows;
+    for (int i = 0; i < 500; ++i) {
+        rows.push_back({i, i % 7, std::string(i % 5 + 1, 'x')});
+    }
+    table.insert_rows(rows);
+
+    REQUIRE(by_id.count() == 500);
+    REQUIRE(table.index<&note::name_length>().count() == 5);
+
+    // Relocation has to move the declared index entries too.
+    for (int i = 0; i < 500; ++i) {
+        if (i % 10 != 0) table.delete_row(by_id.find(i)->oid);
+    }
+    while (not table.compact(size_t(-1), 0.5).finished) {}
+
+    auto &by_length = table.index<&note::name_length>();
+    REQUIRE(by_length.find(1)->value.id == 0);
+    REQUIRE(by_length.find(2) == table.end());
+}
+
+constexpr auto is_even = [](const note &n) { return n.id % 2 == 0; };
+
+TEST_CASE("declared index on a lambda", "[declared_index]") {
+    Table<note, multi_index_on<is_even>> table;
+
+    for (int i = 0; i < 10; ++i) {
+        table.insert_row({i, 0, ""});
+    }
+
+    auto &even = table.index<is_even>();
+    auto rows = even.equal_range(true);
+    REQUIRE(std::distance(rows.begin(), rows.end()) == 5);
+}
+
+TEST_CASE("updating rows in declared indexes", "[declared_index]") {
+    note_table table;
+
+    auto a = table.insert_row({1, 10, "a"})->oid;
+    table.insert_row({2, 10, "b"});
+
+    table.update_row(a, [](note &n) { n.track = 20; n.name = "z"; });
+
+    auto &by_track = table.index<&note::track>();
+    REQUIRE(table.index<&note::id>().find(1)->oid == a);
+    REQUIRE(by_track.find(20)->oid == a);
+    REQUIRE(std::distance(by_track.equal_range(10).begin(), by_track.equal_range(10).end()) == 1);
+    REQUIRE(table.index<&note::name>().find("a") == table.end());
+    REQUIRE(table.index<&note::name>().find("z")->oid == a);
+}
+
+TEST_CASE("an update can update other rows", "[declared_index]") {
+    note_table table;
+    auto &by_big_track = table.create_index<int>("big track",
+        [](const note &n) { return n.track; }, [](const note &n) { return n.track >= 100; });
+
+    auto a = table.insert_row({1, 10, "a"})->oid;
+    auto b = table.insert_row({2, 100, "b"})->oid;
+
+    table.update_row(a, [&](note &n) {
+        n.name = "y";
+        table.update_row(b, [](note &m) { m.name = "z"; m.track = 20; });
+        n.track = 200;
+    });
+
+    auto &by_name = table.index<&note::name>();
+    REQUIRE(by_name.find("y")->oid == a);
+    REQUIRE(by_name.find("z")->oid == b);
+    REQUIRE(by_name.count() == 2);
+    REQUIRE(table.index<&note::track>().find(20)->oid == b);
+    REQUIRE(by_big_track.find(200)->oid == a);
+    REQUIRE(by_big_track.count() == 1);
+}
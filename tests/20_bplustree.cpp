@@ -0,0 +1,443 @@
+#include <bplustree.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("matches std::map", "[bplustree]") {
+    BPT::BPlusTree<int, int, 4> tree;
+    std::map<int, int> ref;
+    std::mt19937 rng(1);
+
+    for (int i = 0; i < 5000; ++i) {
+        int key = rng() % 700;
+        if (rng() % 4 == 0) {
+            REQUIRE(tree.remove(key) == bool(ref.erase(key)));
+        } else {
+            REQUIRE(tree.insert(key, i).second == ref.insert({key, i}).second);
+        }
+    }
+
+    auto expected = ref.begin();
+    for (auto const &kv : tree) {
+        REQUIRE(expected != ref.end());
+        REQUIRE(kv.key == expected->first);
+        REQUIRE(kv.value == expected->second);
+        ++expected;
+    }
+    REQUIRE(expected == ref.end());
+
+    for (int key = 0; key < 700; ++key) {
+        REQUIRE(tree.contains(key) == ref.contains(key));
+    }
+}
+
+TEST_CASE("lower and upper bound", "[bplustree]") {
+    BPT::BPlusTree<int, int, 5> tree;
+    std::map<int, int> ref;
+
+    for (int i = 0; i < 300; ++i) {
+        tree.insert(i * 3, i);
+        ref.insert({i * 3, i});
+    }
+    for (int i = 0; i < 300; i += 4) {
+        tree.remove(i * 3);
+        ref.erase(i * 3);
+    }
+
+    for (int key = -1; key < 905; ++key) {
+        auto lb = tree.lower_bound(key);
+        auto ref_lb = ref.lower_bound(key);
+        REQUIRE((lb == tree.end()) == (ref_lb == ref.end()));
+        if (ref_lb != ref.end()) REQUIRE(lb->key == ref_lb->first);
+
+        auto ub = tree.upper_bound(key);
+        auto ref_ub = ref.upper_bound(key);
+        REQUIRE((ub == tree.end()) == (ref_ub == ref.end()));
+        if (ref_ub != ref.end()) REQUIRE(ub->key == ref_ub->first);
+    }
+}
+
+// Not arithmetic, so searched with the generic binary search.
+struct boxed {
+    long v;
+
+    boxed(long v = 0) : v(v) {}
+
+    friend bool operator<(const boxed &a, const boxed &b) { return a.v < b.v; }
+    friend bool operator==(const boxed &a, const boxed &b) { return a.v == b.v; }
+};
+
+using wide_long = BPT::BPlusTree<long, int, 64>;
+using wide_double = BPT::BPlusTree<double, int, 40>;
+using wide_boxed = BPT::BPlusTree<boxed, int, 64>;
+
+TEMPLATE_TEST_CASE("node search", "[bplustree]", wide_long, wide_double, wide_boxed) {
+    using key_type = typename TestType::key_type;
+
+    static_assert(BPT::branchless_key_search<long>::value);
+    static_assert(BPT::branchless_key_search<double>::value);
+    static_assert(not BPT::branchless_key_search<boxed>::value);
+
+    TestType tree;
+    std::map<long, int> ref;
+    std::mt19937 rng(3);
+
+    for (int i = 0; i < 20000; ++i) {
+        long k = long(rng() % 30000) * 2;
+        REQUIRE(tree.insert(key_type(k), i).second == ref.insert({k, i}).second);
+    }
+    for (int i = 0; i < 5000; ++i) {
+        long k = long(rng() % 30000) * 2;
+        REQUIRE(tree.remove(key_type(k)) == bool(ref.erase(k)));
+    }
+
+    // The keys are even, so every odd probe falls between two of them.
+    for (long k = -1; k < 60002; ++k) {
+        key_type key(k);
+        REQUIRE(tree.contains(key) == ref.contains(k));
+
+        auto lb = tree.lower_bound(key);
+        auto ref_lb = ref.lower_bound(k);
+        REQUIRE((lb == tree.end()) == (ref_lb == ref.end()));
+        if (ref_lb != ref.end()) REQUIRE(lb->key == key_type(ref_lb->first));
+
+        auto ub = tree.upper_bound(key);
+        auto ref_ub = ref.upper_bound(k);
+        REQUIRE((ub == tree.end()) == (ref_ub == ref.end()));
+        if (ref_ub != ref.end()) REQUIRE(ub->key == key_type(ref_ub->first));
+    }
+}
+
+// Walks the tree checking key order, separator bounds, parent links, node
+// occupancy and that the leaf chain links exactly the leaves, in order.
+// Returns the depth of the leaves.
+template<class Tree>
+int check_structure(const Tree &tree) {
+    using node_type = typename Tree::node_type;
+    using internal_type = typename Tree::internal_node_type;
+    using leaf_type = typename Tree::leaf_node_type;
+    using key_type = typename Tree::key_type;
+
+    std::vector<const leaf_type *> leaves;
+
+    // Every key under node is in [*low, *high) - a null bound is open.
+    auto walk = [&](auto &self, const node_type *node, std::size_t depth,
+            const key_type *low, const key_type *high) -> void {
+        auto check_keys = [&](const auto &keys, std::size_t min_keys) {
+            if (node != tree.get_root_ptr()) {
+                REQUIRE(node->num_keys >= min_keys);
+            }
+            for (std::size_t i = 0; i < node->num_keys; ++i) {
+                if (i > 0) REQUIRE(keys[i - 1] < keys[i]);
+                if (low) REQUIRE(not (keys[i] < *low));
+                if (high) REQUIRE(keys[i] < *high);
+            }
+        };
+
+        if (depth == tree.height()) {
+            auto *leaf = static_cast<const leaf_type *>(node);
+            check_keys(leaf->keys, leaf_type::key_limit / 2);
+            leaves.push_back(leaf);
+            return;
+        }
+
+        auto *internal = static_cast<const internal_type *>(node);
+        check_keys(internal->keys, internal_type::key_limit / 2);
+
+        for (std::size_t i = 0; i <= internal->num_keys; ++i) {
+            auto *child = internal->child_ptrs[i];
+            REQUIRE(child->parent == internal);
+            self(self, child, depth + 1,
+                i > 0 ? &internal->keys[i - 1] : low,
+                i < internal->num_keys ? &internal->keys[i] : high);
+        }
+    };
+    walk(walk, tree.get_root_ptr(), 0, nullptr, nullptr);
+
+    std::vector<const leaf_type *> listed;
+    const leaf_type *previous = nullptr;
+    for (auto *leaf = tree.get_first_leaf(); leaf; leaf = leaf->next) {
+        REQUIRE(leaf->previous == previous);
+        listed.push_back(leaf);
+        previous = leaf;
+    }
+    REQUIRE(listed == leaves);
+
+    return int(tree.height());
+}
+
+TEST_CASE("removal rebalances the tree", "[bplustree]") {
+    BPT::BPlusTree<int, int, 4> tree;
+    std::map<int, int> ref;
+    std::mt19937 rng(5);
+
+    for (int round = 0; round < 4; ++round) {
+        for (int i = 0; i < 3000; ++i) {
+            int key = rng() % 2000;
+            tree.insert(key, i);
+            ref.insert({key, i});
+        }
+        check_structure(tree);
+
+        for (int i = 0; i < 4000; ++i) {
+            int key = rng() % 2000;
+            REQUIRE(tree.remove(key) == bool(ref.erase(key)));
+        }
+        check_structure(tree);
+        REQUIRE(tree.compute_size() == ref.size());
+    }
+
+    // Emptying the tree takes it back down to a single leaf.
+    for (auto const &kv : ref) {
+        REQUIRE(tree.remove(kv.first));
+    }
+    REQUIRE(check_structure(tree) == 0);
+    REQUIRE(tree.get_root_ptr()->num_keys == 0);
+    REQUIRE(tree.get_first_leaf() == tree.get_root_ptr());
+    REQUIRE(tree.begin() == tree.end());
+
+    tree.insert(3, 3);
+    REQUIRE(tree.at(3) == 3);
+}
+
+using short_leaves = BPT::BPlusTree<int, int, 32, 3>;
+using long_leaves = BPT::BPlusTree<int, int, 4, 24>;
+
+TEMPLATE_TEST_CASE("leaves sized apart from internal nodes", "[bplustree]", short_leaves, long_leaves) {
+    using narrow = BPT::BPlusTree<int, int, 16>;
+    using wide = BPT::BPlusTree<int, std::array<long, 8>, 16>;
+
+    static_assert(alignof(narrow::internal_node_type) == 64);
+    static_assert(narrow::leaf_capacity == 24);
+    static_assert(wide::leaf_capacity == 15);
+
+    TestType tree;
+    std::map<int, int> ref;
+    std::mt19937 rng(9);
+
+    for (int i = 0; i < 6000; ++i) {
+        int key = rng() % 1500;
+        if (rng() % 3 == 0) {
+            REQUIRE(tree.remove(key) == bool(ref.erase(key)));
+        } else {
+            REQUIRE(tree.insert(key, i).second == ref.insert({key, i}).second);
+        }
+    }
+    check_structure(tree);
+    REQUIRE(tree.compute_size() == ref.size());
+
+    std::vector<std::pair<int, int>> sorted(ref.begin(), ref.end());
+    tree.bulk_load(sorted, 0.5);
+    check_structure(tree);
+    REQUIRE(tree.compute_size() == ref.size());
+}
+
+TEST_CASE("lazy removal", "[bplustree]") {
+    BPT::BPlusTree<int, int, 6> tree;
+    for (int i = 0; i < 500; ++i) {
+        tree.insert(i, i);
+    }
+    int depth = check_structure(tree);
+
+    tree.lazy_removal(true);
+    for (int i = 0; i < 500; i += 2) {
+        REQUIRE(tree.remove(i));
+    }
+    REQUIRE_FALSE(tree.remove(0));
+    REQUIRE(tree.tombstones() == 250);
+    REQUIRE(tree.compute_size() == 250);
+    REQUIRE_FALSE(tree.contains(10));
+    REQUIRE_THROWS(tree.at(10));
+    REQUIRE(tree.lower_bound(10)->key == 11);
+    REQUIRE(check_structure(tree) == depth);
+
+    // a tombstone is reused by an insert of its key.
+    REQUIRE(tree.insert(10, 99).second);
+    REQUIRE(tree.tombstones() == 249);
+    REQUIRE(tree.at(10) == 99);
+
+    // A copy stays lazy, but leaves the tombstones behind.
+    auto copy = tree;
+    REQUIRE(copy.lazy_removal());
+    REQUIRE(copy.tombstones() == 0);
+    REQUIRE(copy.compute_size() == 251);
+    REQUIRE(copy.remove(11));
+    REQUIRE(copy.tombstones() == 1);
+
+    BPT::BPlusTree<int, int, 6> eager;
+    eager = tree;
+    REQUIRE(eager.lazy_removal());
+
+    tree.purge();
+    REQUIRE(tree.tombstones() == 0);
+    REQUIRE(tree.compute_size() == 251);
+    REQUIRE(tree.lazy_removal());
+    check_structure(tree);
+
+    for (int i = 1; i < 500; i += 2) {
+        tree.remove(i);
+    }
+    tree.lazy_removal(false);
+    REQUIRE(tree.tombstones() == 0);
+    REQUIRE(tree.compute_size() == 1);
+    REQUIRE(check_structure(tree) == 0);
+}
+
+TEST_CASE("iteration walks the leaves", "[bplustree]") {
+    BPT::BPlusTree<int, int, 5> tree;
+    std::vector<int> keys;
+
+    REQUIRE(tree.rbegin() == tree.rend());
+
+    for (int i = 0; i < 400; ++i) {
+        tree.insert(i, i);
+    }
+    tree.lazy_removal(true);
+    for (int i = 0; i < 400; ++i) {
+        if (i % 3 == 0 or (i >= 100 and i < 150)) {
+            tree.remove(i);
+        } else {
+            keys.push_back(i);
+        }
+    }
+
+    std::vector<int> forward;
+    for (auto const &kv : tree) {
+        forward.push_back(kv.key);
+    }
+    REQUIRE(forward == keys);
+
+    std::vector<int> backward;
+    for (auto iter = tree.rbegin(); iter != tree.rend(); ++iter) {
+        backward.push_back(iter->key);
+    }
+    std::reverse(backward.begin(), backward.end());
+    REQUIRE(backward == keys);
+
+    // Values live in the leaves and can be changed through an iterator.
+    auto iter = tree.find(7);
+    REQUIRE(&iter->value == &tree.at(7));
+    iter->value = 70;
+    REQUIRE(tree.at(7) == 70);
+}
+
+TEST_CASE("bulk load", "[bplustree]") {
+    for (double fill : {0.5, 0.7, 1.0}) {
+        for (int n = 0; n < 300; n += 7) {
+            std::vector<std::pair<int, int>> entries;
+            for (int i = 0; i < n; ++i) {
+                entries.push_back({i * 2, i});
+            }
+
+            BPT::BPlusTree<int, int, 5> tree;
+            tree.insert(-1, -1);
+            REQUIRE(tree.bulk_load(entries, fill) == std::size_t(n));
+            check_structure(tree);
+            REQUIRE(tree.compute_size() == std::size_t(n));
+            REQUIRE_FALSE(tree.contains(-1));
+
+            for (int i = 0; i < n; ++i) {
+                REQUIRE(tree.at(i * 2) == i);
+                REQUIRE_FALSE(tree.contains(i * 2 + 1));
+            }
+
+            // the loaded tree takes inserts and removals as usual.
+            for (int i = 0; i < n; i += 3) {
+                tree.insert(i * 2 + 1, 0);
+                tree.remove(i * 2);
+            }
+            check_structure(tree);
+        }
+    }
+}
+
+TEST_CASE("bulk load input checks", "[bplustree]") {
+    std::vector<std::pair<int, int>> entries{{1, 1}, {2, 2}, {2, 3}, {5, 5}};
+
+    BPT::BPlusTree<int, int, 4> tree(entries.begin(), entries.end());
+    REQUIRE(tree.compute_size() == 3);
+    REQUIRE(tree.at(2) == 2);
+
+    std::vector<std::pair<int, int>> unsorted{{1, 1}, {3, 3}, {2, 2}};
+    REQUIRE_THROWS(tree.bulk_load(unsorted));
+    REQUIRE(tree.compute_size() == 3);
+    REQUIRE(tree.at(5) == 5);
+
+    BPT::BPlusTree<int, int, 4> big;
+    for (int i = 0; i < 1000; ++i) {
+        big.insert((i * 37) % 1000, i);
+    }
+    big.remove(500);
+
+    BPT::BPlusTree<int, int, 4> copy(big);
+    check_structure(copy);
+    REQUIRE(copy.compute_size() == 999);
+    REQUIRE(std::equal(copy.begin(), copy.end(), big.begin(), big.end(),
+        [](auto const &a, auto const &b) { return a.key == b.key and a.value == b.value; }));
+
+    copy = copy;
+    REQUIRE(copy.compute_size() == 999);
+
+    for (double fill : {0.0, -1.0, 1.5, std::nan("")}) {
+        REQUIRE_THROWS(tree.bulk_load(entries, fill));
+    }
+    REQUIRE(tree.compute_size() == 3);
+}
+
+// Copying one of these throws once copies_left runs out (-1: never).
+struct touchy {
+    int v;
+    static inline int copies_left = -1;
+
+    touchy(int v = 0) : v(v) {}
+    touchy(const touchy &other) : v(other.v) { spend(); }
+    touchy(touchy &&) = default;
+    touchy &operator=(const touchy &other) { spend(); v = other.v; return *this; }
+    touchy &operator=(touchy &&) = default;
+
+    static void spend() {
+        if (copies_left == 0) throw std::runtime_error("copy failed");
+        if (copies_left > 0) --copies_left;
+    }
+
+    friend bool operator<(const touchy &a, const touchy &b) { return a.v < b.v; }
+    friend bool operator==(const touchy &a, const touchy &b) { return a.v == b.v; }
+};
+
+TEST_CASE("bulk load is all or nothing", "[bplustree]") {
+    BPT::BPlusTree<touchy, int, 4> tree;
+    tree.insert(1, 1);
+    tree.insert(2, 2);
+
+    std::vector<std::pair<touchy, int>> entries;
+    for (int i = 0; i < 200; ++i) {
+        entries.push_back({i, i});
+    }
+
+    // Fail at every copy in turn, until the load gets through.
+    for (int budget = 0; ; ++budget) {
+        touchy::copies_left = budget;
+        bool threw = false;
+        try {
+            tree.bulk_load(entries);
+        } catch (std::runtime_error const &) {
+            threw = true;
+        }
+        touchy::copies_left = -1;
+
+        if (not threw) break;
+        REQUIRE(tree.compute_size() == 2);
+        REQUIRE(tree.at(2) == 2);
+        check_structure(tree);
+    }
+
+    REQUIRE(tree.compute_size() == 200);
+    check_structure(tree);
+}